@@ -31,6 +31,7 @@
 #include "cerop/error.hpp"
 #include "cerop/util.hpp"
 #include "cerop/bind.hpp"
+#include "cerop/keyindex.hpp"
 
 
 #endif //ROP_CEROP_H
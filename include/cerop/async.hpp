@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2020 Janky <box@janky.tech>
+ * All right reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ROP_ASYNC_H
+#define ROP_ASYNC_H
+
+#include <memory>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <exception>
+#include "types.hpp"
+
+
+CEROP_NAMESPACE_BEGIN {
+
+class RopSessionT;
+typedef std::shared_ptr<RopSessionT> RopSession;
+
+/** 
+ * Fixed set of worker threads fed from a bounded queue.
+ * If a session factory is given, every worker creates its own session
+ * on start and hands it to the tasks it runs; the constructor rethrows
+ * the first failure of the factory.
+ * @version 0.21
+ * @since   0.21
+ */
+class RopWorkerPool final {
+public:
+    typedef std::function<RopSession()> SessionFactory;
+    typedef std::function<void(const RopSession&)> Task;
+
+    RopWorkerPool(const size_t threads, const size_t maxQueued, const SessionFactory& factory = nullptr);
+    // runs the tasks still queued, then joins the workers
+    ~RopWorkerPool();
+
+    RopWorkerPool(const RopWorkerPool&) = delete;
+    RopWorkerPool& operator =(const RopWorkerPool&) = delete;
+
+    // waits while the queue is full
+    void submit(const Task& task);
+    // fails instead of waiting
+    bool try_submit(const Task& task);
+    size_t queued() const;
+
+    /**
+     * Runs fx on a worker. If wait is false and the queue is full
+     * the returned future is not valid().
+     */
+    template<class R>
+    std::future<R> async(const std::function<R(const RopSession&)>& fx, const bool wait = true) {
+        std::shared_ptr<std::promise<R>> done = std::make_shared<std::promise<R>>();
+        std::future<R> result = done->get_future();
+        Task task = [fx, done](const RopSession& ses) { Fulfil(*done, fx, ses); };
+        if(wait)
+            submit(task);
+        else if(!try_submit(task))
+            return std::future<R>();
+        return result;
+    }
+
+protected:
+    void Run();
+
+    template<class R>
+    static void Fulfil(std::promise<R>& done, const std::function<R(const RopSession&)>& fx, const RopSession& ses) {
+        try {
+            done.set_value(fx(ses));
+        } catch(...) {
+            done.set_exception(std::current_exception());
+        }
+    }
+    static void Fulfil(std::promise<void>& done, const std::function<void(const RopSession&)>& fx, const RopSession& ses);
+
+    const size_t maxQueued;
+    const SessionFactory factory;
+    mutable std::mutex lock;
+    std::condition_variable notEmpty, notFull, ready;
+    std::deque<Task> tasks;
+    std::vector<std::thread> workers;
+    std::exception_ptr startError;
+    size_t started;
+    bool stopping;
+};
+
+} CEROP_NAMESPACE_END
+
+#endif // ROP_ASYNC_H
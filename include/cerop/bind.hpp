@@ -40,6 +40,7 @@ class RopBindT;
 typedef std::shared_ptr<RopBindT> RopBind;
 
 #define NewRopBind RopBindT::New
+#define SharedRopBind RopBindT::Shared
     
 /**
  * Root object of bindings for the RNP OpenPGP library
@@ -49,9 +50,35 @@ typedef std::shared_ptr<RopBindT> RopBind;
 class RopBindT : public RopObjectT {
 public:
     static RopBind New(const bool checkLibVer = true);
+    /**
+     * Process-wide bind, created on the first call and shared afterwards.
+     * checkLibVer applies to the first call only.
+     */
+    static RopBind Shared(const bool checkLibVer = true);
 
     virtual ~RopBindT();
 
+    /**
+     * Optional parts of the RNP API, probed once when the library is bound
+     */
+    enum class Capability : unsigned {
+        CORE,                   // functions the bindings cannot work without
+        AEAD,                   // AEAD encryption, including runtime support
+        SM2,                    // SM2 keys, including runtime support
+        KEY_VALIDITY,           // is_valid/valid_till of keys and uids
+        KEY_PROTECTION_INFO,    // protection_type/mode/cipher/hash/iterations
+        REVOCATION,             // revoke, export_revocation, revocation reasons
+        AUTOCRYPT,              // export_autocrypt
+        KEY_REMOVAL,            // RopKeyT::remove
+        SIGNATURE_IMPORT,       // import_signatures
+        DECRYPTION_INFO,        // protection, recipient and symenc info of RopOpVerifyT
+        PASSWORD_REQUEST,       // request_password
+        ARMOR_LINE_LENGTH       // armor_set_line_length
+    };
+
+    inline bool has(const Capability cap) const noexcept { return (capabilities & (1u << static_cast<unsigned>(cap))) != 0; }
+    inline uint32_t get_capabilities() const noexcept { return capabilities; }
+
     // API
 
     RopString default_homedir();
@@ -78,12 +105,27 @@ public:
     RopInput create_input(const RopDataT& buf, const bool doCopy);
     RopInput create_input(const InString& path);
     RopInput create_input(InputCallBack& inputCB, void* app_ctx);
+    RopInput create_input_mmap(const InString& path);
+    RopInput create_input_fd(const int fd);
+    /**
+     * Input reading the segments in order without joining them.
+     * The segment data must outlive the input.
+     */
+    RopInput create_input(const RopIoVec* segs, const size_t count);
 
     RopOutput create_output(const InString& toFile, const bool overwrite, const bool random);
     RopOutput create_output(const InString& toPath);
     RopOutput create_output(const size_t maxAlloc);
     RopOutput create_output();
     RopOutput create_output(OutputCallBack& outputCB, void* app_ctx);
+    RopOutput create_output_fd(const int fd);
+    /**
+     * Outputs appending to, or filling, storage owned by the caller.
+     * The data is complete once the output has been released.
+     */
+    RopOutput create_output_memory(std::vector<uint8_t>& buf);
+    RopOutput create_output_memory(StringT& buf);
+    RopOutput create_output_memory(void* buf, const size_t size, size_t* written);
 
     /**
      * Describes this object
@@ -143,6 +185,17 @@ protected:
      */
     RopBindT(const bool checkLibVer = true);
 
+    RopInput create_input_source(const std::shared_ptr<InputCallBack>& source);
+    RopOutput create_output_sink(const std::shared_ptr<OutputCallBack>& sink);
+    // throws ERROR_BAD_PARAMETERS unless fd is an open descriptor
+    static void CheckFd(const int fd);
+
+    uint32_t capabilities;
+    RopErrorQueueT errors;
+
+    static void AcquireLib();
+    static void ReleaseLib();
+
     static std::atomic_long instanceCnt;
 };
 
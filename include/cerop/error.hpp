@@ -48,7 +48,7 @@ public:
 protected:
     RopError(const unsigned errCode) noexcept;
 
-    StringT message;
+    char message[24];
     int errCode;
 
 friend class RopBindT;
@@ -67,6 +67,10 @@ friend class RopOpVerifyT;
 friend class RopIdIteratorT;
 friend class RopObjectT;
 friend class Util;
+friend class RopKeyIndex;
+friend class KeyringKeyProvider;
+friend class RopKeyShards;
+template<class T> friend class RopResult;
 };
 
 
@@ -116,6 +120,67 @@ public:
     static const unsigned ERROR_NULL_HANDLE;
 };
 
+
+/**
+ * An error code on its way into a RopResult, kept apart from the value
+ * so that a RopResult of an integral type can not mistake one for the other
+ * @version 0.21
+ * @since   0.21
+ */
+struct RopFailure {
+    inline explicit RopFailure(const unsigned errCode) noexcept : errCode(errCode) {}
+    unsigned errCode;
+};
+
+/** 
+ * A value or the result code explaining its absence,
+ * returned by the non-throwing variants of the API;
+ * an RNP function missing from the library yields ERROR_NOT_IMPLEMENTED
+ * @version 0.21
+ * @since   0.21
+ */
+template<class T>
+class RopResult {
+public:
+    inline RopResult(const T& value) noexcept : value(value), errCode(ROPE::SUCCESS) {}
+    inline RopResult(const RopFailure& failure) noexcept : value(), errCode(failure.errCode) {}
+    inline static RopResult Error(const unsigned errCode) noexcept { return RopResult(RopFailure(errCode)); }
+
+    inline bool ok() const noexcept { return errCode == ROPE::SUCCESS; }
+    inline explicit operator bool() const noexcept { return ok(); }
+    inline unsigned getErrCode() const noexcept { return errCode; }
+    inline const T& get() const {
+        if(!ok())
+            throw RopError(errCode);
+        return value;
+    }
+    inline const T& operator *() const noexcept { return value; }
+    inline const T* operator ->() const noexcept { return &value; }
+
+protected:
+    T value;
+    unsigned errCode;
+};
+
+template<>
+class RopResult<void> {
+public:
+    inline RopResult(const unsigned errCode = ROPE::SUCCESS) noexcept : errCode(errCode) {}
+    inline RopResult(const RopFailure& failure) noexcept : errCode(failure.errCode) {}
+    inline static RopResult Error(const unsigned errCode) noexcept { return RopResult(errCode); }
+
+    inline bool ok() const noexcept { return errCode == ROPE::SUCCESS; }
+    inline explicit operator bool() const noexcept { return ok(); }
+    inline unsigned getErrCode() const noexcept { return errCode; }
+    inline void get() const {
+        if(!ok())
+            throw RopError(errCode);
+    }
+
+protected:
+    unsigned errCode;
+};
+
 } CEROP_NAMESPACE_END
 
 #endif // ROP_ERROR_H
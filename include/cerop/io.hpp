@@ -29,6 +29,7 @@
 #define ROP_IO_H
 
 #include <memory>
+#include <vector>
 #include "types.hpp"
 
 
@@ -40,6 +41,14 @@ typedef std::shared_ptr<RopInputT> RopInput;
 class RopOutputT;
 typedef std::shared_ptr<RopOutputT> RopOutput;
 
+/**
+ * A segment of a scattered buffer, laid out like POSIX struct iovec
+ */
+struct RopIoVec {
+    const void *base;
+    size_t len;
+};
+
 interface InputCallBack {
     virtual bool ReadCallBack(void *ctx, void *buf, size_t len, size_t *read) = 0;
     virtual void RCloseCallBack(void *ctx) = 0;
@@ -50,6 +59,47 @@ interface OutputCallBack {
     virtual void WCloseCallBack(void *ctx, bool discard) = 0;
 };
 
+/**
+ * Reads ahead from another InputCallBack in chunks of a fixed size,
+ * serving the small reads of RNP from its buffer. Reads of at least
+ * a chunk go straight to the underlying callback.
+ */
+class BufferedInputCallBack : public InputCallBack {
+public:
+    BufferedInputCallBack(InputCallBack& inputCB, const size_t chunkSize = 64*1024);
+
+    virtual bool ReadCallBack(void *ctx, void *buf, size_t len, size_t *read) override;
+    virtual void RCloseCallBack(void *ctx) override;
+
+protected:
+    InputCallBack &inputCB;
+    std::vector<uint8_t> chunk;
+    size_t pos, fill;
+    bool eof;
+};
+
+/**
+ * Coalesces the writes of RNP into chunks of a fixed size before
+ * passing them to another OutputCallBack. Whatever is left is written
+ * out on close unless the output is discarded; failed() tells whether
+ * any write to the underlying callback, that one included, failed.
+ */
+class BufferedOutputCallBack : public OutputCallBack {
+public:
+    BufferedOutputCallBack(OutputCallBack& outputCB, const size_t chunkSize = 64*1024);
+
+    virtual bool WriteCallBack(void *ctx, const void *buf, size_t len) override;
+    virtual void WCloseCallBack(void *ctx, bool discard) override;
+    bool Flush(void *ctx);
+    inline bool failed() const noexcept { return flushFailed; }
+
+protected:
+    OutputCallBack &outputCB;
+    std::vector<uint8_t> chunk;
+    size_t fill;
+    bool flushFailed;
+};
+
 
 class RopInputT : public RopObjectT {
 public:
@@ -86,10 +136,23 @@ protected:
     RopInputT(const RopObjRef& parent, const RopHandle iid);
     RopInputT(const RopObjRef& parent, InputCallBack* inputCB, void* app_ctx);
 
+    void MapFile(const char* path);
+    void UnmapFile() noexcept;
+    bool ReadFd(void *buf, size_t len, size_t *read) noexcept;
+    static bool PipeFd(const int inFd, const int outFd);
+
     InputCallBack *inputCB;
     void *inpcbCtx;
+    std::shared_ptr<InputCallBack> source;  // owned reader of a scattered input
+    const void *mapBuf;  // read-only file mapping backing the input
+    size_t mapLen;
+    int fd;              // caller's descriptor backing the input, or -1
+    bool fdUsed;
 
 friend class RopBindT;
+friend class RopKeyIndex;
+friend class KeyringKeyProvider;
+friend class RopKeyShards;
 friend bool input_reader(void*, void*, size_t, size_t *);
 friend void input_closer(void*);
 };
@@ -110,10 +173,16 @@ protected:
     RopOutputT(const RopObjRef& parent, const RopHandle oid);
     RopOutputT(const RopObjRef& parent, OutputCallBack* outputCB, void* app_ctx);
 
+    bool WriteFd(const void *buf, size_t len) noexcept;
+
     OutputCallBack *outputCB;
     void *outpcbCtx;
+    std::shared_ptr<OutputCallBack> sink;  // owned writer of a memory output
+    int fd;              // caller's descriptor backing the output, or -1
+    bool fdUsed;
 
 friend class RopBindT;
+friend class RopInputT;
 friend bool output_writer(void*, const void*, size_t);
 friend void output_closer(void*, bool);
 };
@@ -41,6 +41,37 @@ typedef std::shared_ptr<RopUidHandleT> RopUidHandle;
 class RopKeyT;
 typedef std::shared_ptr<RopKeyT> RopKey;
 
+/**
+ * Commonly used properties of a key, read in one pass into fixed
+ * buffers; strings a key does not have are left empty, longer ones
+ * are cut at a UTF-8 character boundary (primaryUid to 255 bytes).
+ * validTill and valid stay at their defaults when the library lacks
+ * Capability::KEY_VALIDITY.
+ */
+struct RopKeySnapshotT {
+    char keyid[17];
+    char fprint[65];
+    char grip[41];
+    char primaryFprint[65];
+    char alg[16];
+    char curve[32];
+    char primaryUid[256];
+    uint32_t bits;
+    Instant creation;
+    Duration expiration;
+    Instant validTill;
+    size_t uidCount;
+    size_t subkeyCount;
+    size_t signatureCount;
+    bool primary;
+    bool valid;
+    bool revoked;
+    bool haveSecret;
+    bool havePublic;
+    bool isProtected;
+    bool locked;
+};
+
 
 class RopUidHandleT : public RopObjectT {
 public:
@@ -138,10 +169,16 @@ public:
     inline void remove_secret(const bool subkeys = false) {
         remove(false, true, subkeys);
     }
+    RopKeySnapshotT snapshot();
 
 protected:
     RopKeyT(const RopObjRef& parent, const RopHandle uid);
 
+    // validity false skips validTill and valid, for libraries without KEY_VALIDITY
+    static void Snapshot(const RopHandle key, RopKeySnapshotT& snap, const bool validity);
+    // tells the session that its keys change
+    void Edited() noexcept;
+
 friend class RopSessionT;
 friend class RopSignT;
 friend class RopOpGenerateT;
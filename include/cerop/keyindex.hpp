@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2020 Janky <box@janky.tech>
+ * All right reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ROP_KEYINDEX_H
+#define ROP_KEYINDEX_H
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include "types.hpp"
+#include "session.hpp"
+
+
+CEROP_NAMESPACE_BEGIN {
+
+/** 
+ * On-disk index of a binary keyring: identifiers (keyid, fingerprint,
+ * grip, userid) of every key and subkey map to the byte range of the
+ * key in the keyring. Installed as the key provider of a session, it
+ * loads only the keys that RNP asks for.
+ * @version 0.21
+ * @since   0.21
+ */
+class RopKeyIndex : public SessionKeyCallBack {
+public:
+    /**
+     * Splits a binary keyring into the byte ranges of its transferable
+     * keys, each starting with a public or secret key packet; packets
+     * before the first key are skipped. Returns false on bad framing.
+     */
+    static bool split_keys(const uint8_t* data, const size_t len, std::vector<std::pair<size_t, size_t>>& keys);
+    // scans a binary keyring and writes its index
+    static void build(const RopBind& bind, const InString& keyring, const InString& index);
+
+    RopKeyIndex(const RopBind& bind, const InString& keyring, const InString& index);
+
+    // loads the keys matching the identifier into the session, false if none is indexed
+    bool load_key(const RopSession& ses, const InString& identifier_type, const InString& identifier);
+    size_t size() const noexcept;
+
+    virtual void KeyCallBack(const RopSession& ses, void* ctx, const InString& identifier_type, const InString& identifier, const bool secret) override;
+
+protected:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t order;
+        uint64_t count;
+    };
+    struct Entry {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    const RopBind bind;
+    RopInput ring;
+    RopInput index;
+    const Entry *entries;
+    size_t count;
+};
+
+/** 
+ * Key provider over keyrings scanned in memory at start up: a binary
+ * keyring file, or every file of a directory. Each request loads only
+ * the matching key into the session, a miss costs one hash lookup.
+ * All add() calls must be done before the provider is installed; after
+ * that it is only read and may serve several sessions at once.
+ * @version 0.21
+ * @since   0.21
+ */
+class KeyringKeyProvider : public SessionKeyCallBack {
+public:
+    KeyringKeyProvider(const RopBind& bind);
+
+    // scans a binary keyring, or every regular file of a directory
+    void add(const InString& path);
+    // loads the keys matching the identifier into the session, false if none is known
+    bool load_key(const RopSession& ses, const InString& identifier_type, const InString& identifier);
+    size_t size() const noexcept;
+
+    virtual void KeyCallBack(const RopSession& ses, void* ctx, const InString& identifier_type, const InString& identifier, const bool secret) override;
+
+protected:
+    struct Slot {
+        size_t file;
+        size_t offset;
+        size_t length;
+    };
+
+    void AddFile(const char* path);
+
+    const RopBind bind;
+    std::vector<RopInput> files;
+    std::vector<Slot> keys;
+    std::unordered_multimap<uint64_t, size_t> ids;
+};
+
+/** 
+ * Binary keyring split at key boundaries into parts of similar size,
+ * each loaded into its own session on its own thread.
+ * Lookups go through the shards in turn.
+ * @version 0.21
+ * @since   0.21
+ */
+class RopKeyShards final {
+public:
+    // threads 0 means one per hardware thread
+    RopKeyShards(const RopBind& bind, const InString& keyring, const size_t threads = 0);
+    RopKeyShards(const RopKeyShards&) = delete;
+    RopKeyShards& operator =(const RopKeyShards&) = delete;
+
+    // first key matching the identifier in any shard, empty if none
+    RopKey locate_key(const InString& identifier_type, const InString& identifier);
+    inline size_t size() const noexcept { return shards.size(); }
+    inline const RopSession& shard(const size_t idx) const { return shards.at(idx); }
+
+protected:
+    const RopBind bind;
+    RopInput ring;
+    std::vector<RopSession> shards;
+};
+
+} CEROP_NAMESPACE_END
+
+#endif // ROP_KEYINDEX_H
@@ -30,6 +30,7 @@
 
 #include "types.hpp"
 #include "sign.hpp"
+#include "async.hpp"
 
 
 CEROP_NAMESPACE_BEGIN {
@@ -95,6 +96,8 @@ public:
     void set_file_name(const InString& filename);
     void set_file_mtime(const Instant& mtime);
     void execute();
+    // serialized with the other async calls of the session, see RopSessionT::decrypt_async
+    std::future<void> execute_async(RopWorkerPool& pool, const bool wait = true);
     RopSignSignature add_signature(const RopKey& key);
 
 protected:
@@ -165,6 +168,8 @@ public:
     void set_file_name(const InString& filename);
     void set_file_mtime(const Instant& mtime);
     void execute();
+    // serialized with the other async calls of the session, see RopSessionT::decrypt_async
+    std::future<void> execute_async(RopWorkerPool& pool, const bool wait = true);
 
 protected:
     RopOpEncryptT(const RopObjRef& parent, const RopHandle eid);
@@ -246,6 +251,9 @@ public:
 
     size_t signature_count();
     void execute();
+    RopResult<void> try_execute() noexcept;
+    // serialized with the other async calls of the session, see RopSessionT::decrypt_async
+    std::future<void> execute_async(RopWorkerPool& pool, const bool wait = true);
     RopVeriSignature get_signature_at(size_t idx);
     FileInfoP get_file_info();
     bool get_protection_info(RopString* mode, RopString* cipher);
@@ -30,7 +30,12 @@
 
 #include <memory>
 #include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
 #include "types.hpp"
+#include "error.hpp"
 #include "io.hpp"
 #include "key.hpp"
 #include "op.hpp"
@@ -49,6 +54,16 @@ typedef std::shared_ptr<RopBindT> RopBind;
     
 interface SessionPassCallBack;
 interface SessionKeyCallBack;
+interface SessionImportCallBack;
+
+/**
+ * Keys of a session kept as serialized GPG packets, restorable into
+ * any number of sessions without saving them again
+ */
+struct RopSnapshotT {
+    std::vector<uint8_t> pub, sec;
+};
+typedef std::shared_ptr<const RopSnapshotT> RopSnapshot;
     
     
 /**
@@ -92,6 +107,14 @@ public:
         load_keys(format, input, false, true);
     }
     void unload_keys(const bool pub = true, const bool sec = true);
+    /**
+     * Brings the keyring in line with the keys read from input: keys
+     * missing there are removed, new or changed ones are imported.
+     * A changed key that lost packets (subkeys, user ids, signatures or
+     * secret material) is removed and imported again, which invalidates
+     * its handles. Handles of all other keys stay valid.
+     */
+    void reload_keys(const InString& format, const RopInput& input);
     inline void unload_keys_public() {
         unload_keys(true, false);
     }
@@ -99,6 +122,21 @@ public:
         unload_keys(false, true);
     }
     RopKey locate_key(const InString& identifier_type, const InString& identifier);
+    /**
+     * Keeps up to capacity located keys, most recently used first, and
+     * serves repeated lookups from them; 0 turns the cache off.
+     * Loading, unloading, importing and removing keys clears it.
+     */
+    void set_key_cache(const size_t capacity);
+    RopResult<RopKey> try_locate_key(const InString& identifier_type, const InString& identifier) noexcept;
+    /**
+     * Looks up every identifier in ids, in order.
+     * Identifiers that do not resolve to a key yield an empty RopKey,
+     * any other failure is thrown.
+     */
+    std::vector<RopKey> locate_keys(const InString& identifier_type, const StringsT& ids);
+    // snapshots of every key and subkey without creating key handlers
+    std::vector<RopKeySnapshotT> key_snapshots();
     RopKey generate_key_rsa(const uint32_t bits, const uint32_t subbits, const InString& userid, const InString& password);
     RopKey generate_key_dsa_eg(const uint32_t bits, const uint32_t subbits, const InString& userid, const InString& password);
     RopKey generate_key_ec(const InString& curve, const InString& userid, const InString& password);
@@ -106,12 +144,21 @@ public:
     RopKey generate_key_sm2(const InString& userid, const InString& password);
     RopKey generate_key_ex(const InString& keyAlg, const InString& subAlg, const uint32_t keyBits, const uint32_t subBits, const InString& keyCurve, const InString& subCurve, const InString& userid, const InString& password);
     RopData import_keys(const RopInput& input, const bool pub = true, const bool sec = true, const bool perm = false, bool sngl = false);
+    RopResult<RopData> try_import_keys(const RopInput& input, const bool pub = true, const bool sec = true, const bool perm = false, bool sngl = false) noexcept;
     inline RopData import_keys_public(const RopInput& input, const bool permissive = false) {
         return import_keys(input, true, false, permissive);
     }
     inline RopData import_keys_secret(const RopInput& input, const bool permissive = false) {
         return import_keys(input, false, true, permissive);
     }
+    /**
+     * Imports the keys of input one at a time, reporting each imported
+     * key and subkey to the callback; returns the number reported.
+     * A key is imported together with its subkeys, so after the callback
+     * returns false the rest of that key is still reported before the
+     * import stops.
+     */
+    size_t import_keys_stream(const RopInput& input, SessionImportCallBack* importcb, void* importcbCtx, const bool pub = true, const bool sec = true, const bool perm = false);
     void set_pass_provider(SessionPassCallBack* getpasscb, void* getpasscbCtx);
     RopIdIterator identifier_iterator_create(const InString& identifier_type);
     void set_log_fd(const int fd);
@@ -125,17 +172,62 @@ public:
         save_keys(format, output, false, true);
     }
     RopData generate_key_json(const RopDataT& json);
+    RopSnapshot snapshot();
+    // replaces the keys of the session with the snapshot
+    void restore(const RopSnapshot& snap);
+    // a new session holding the same keys
+    RopSession clone();
     void decrypt(const RopInput& input, const RopOutput& output);
+    /**
+     * Runs decrypt() on a worker of pool. Async calls made through one
+     * session, including execute_async of its operations, run one at a
+     * time since they share the FFI: a call made while another one is
+     * pending waits in the session rather than on a worker, so queued
+     * work of one session never holds up the workers. With wait false
+     * the future is not valid() only if the call would start the chain
+     * and the pool queue is full. The session must not be used from
+     * other threads until the future is ready.
+     */
+    std::future<void> decrypt_async(RopWorkerPool& pool, const RopInput& input, const RopOutput& output, const bool wait = true);
 
 protected:
     RopSessionT(const RopObjRef& parent, const RopHandle sid);
+
+    struct KeyCache;
+    RopKey CachedKey(const char* identifier_type, const char* identifier);
+    RopKey CacheKey(const char* identifier_type, const char* identifier, const RopHandle handle);
+    RopKey KeyView(const RopKey& cached);
+    void InvalidateKeys() noexcept;
+    // digests of the listed primary keys, of all of them without a list
+    void DigestKeys(std::unordered_map<StringT, uint64_t>& digests, const StringsT* fprints = nullptr);
+    std::vector<uint8_t> ExportKeys(const StringsT& fprints);
+    void RemoveKeys(const StringsT& fprints);
+    template<typename F> void WithKey(const char* fprint, F fn);
+    // the session an object was created in, nullptr if none
+    static RopSessionT* SessionOf(RopObjectT* obj) noexcept;
+    // runs fx on pool after the async calls already pending on ses
+    static std::future<void> Serialized(RopSessionT* ses, RopWorkerPool& pool, const std::function<void()>& fx, const bool wait);
+    struct AsyncChain;
+    static void RunChain(const std::shared_ptr<AsyncChain>& chain, std::function<void()> job);
     
+    RopErrorQueueT errors;
+    std::shared_ptr<AsyncChain> asyncChain;
+    KeyCache *keyCache;
+    std::unordered_map<StringT, uint64_t> keyDigests;
+    bool digestsValid;
     SessionPassCallBack *passProvider;
     void *passcbCtx;
     SessionKeyCallBack *keyProvider;
     void *keycbCtx;
+    // bumped by every change to the keys or the providers
+    uint64_t keyEdits;
 
 friend class RopBindT;
+friend class RopSessionPool;
+friend class RopKeyT;
+friend class RopOpSignT;
+friend class RopOpEncryptT;
+friend class RopOpVerifyT;
 friend bool password_cb(void*, void*, void*, const char*, char*, size_t);
 friend void key_cb(void*, void*, const char*, const char*, bool);
 };
@@ -171,6 +263,86 @@ interface SessionKeyCallBack {
     virtual void KeyCallBack(const RopSession& ses, void* ctx, const InString& identifier_type, const InString& identifier, const bool secret) = 0;
 };
 
+
+interface SessionImportCallBack {
+    enum Status { NONE, UNCHANGED, UPDATED, NEW, UNKNOWN };
+    struct Key {
+        char fprint[65];
+        Status pub;
+        Status sec;
+    };
+    // returns false to stop the import before the next primary key
+    virtual bool ImportCallBack(const RopSession& ses, void* ctx, const Key& key) = 0;
+};
+
+
+/**
+ * A fixed number of sessions holding replicas of one keyring, so that
+ * threads can work in parallel without sharing an FFI. The keyring is
+ * loaded once; replicas are brought up to date by refresh() lazily,
+ * the next time they are leased. A session whose keys or providers
+ * were changed while leased is restored before it is leased again.
+ * @version 0.21
+ * @since   0.21
+ */
+class RopSessionPool final {
+protected:
+    struct Replica {
+        RopSession ses;
+        unsigned gen;
+        // keyEdits of the session when it was last brought up to date
+        uint64_t edits;
+        bool changed;
+    };
+
+public:
+    class Lease {
+    public:
+        inline Lease() noexcept : pool(nullptr), replica() {}
+        inline Lease(Lease&& other) noexcept : pool(other.pool), replica(std::move(other.replica)) { other.pool = nullptr; }
+        Lease& operator =(Lease&& other) noexcept;
+        inline ~Lease() { release(); }
+
+        inline const RopSession& get() const noexcept { return replica.ses; }
+        inline RopSessionT* operator ->() const noexcept { return replica.ses.get(); }
+        inline explicit operator bool() const noexcept { return replica.ses != nullptr; }
+        void release() noexcept;
+
+    private:
+        inline Lease(RopSessionPool* pool, const Replica& replica) noexcept : pool(pool), replica(replica) {}
+
+        RopSessionPool *pool;
+        Replica replica;
+
+    friend class RopSessionPool;
+    };
+
+    RopSessionPool(const RopBind& bind, const size_t size);
+    RopSessionPool(const RopSessionPool&) = delete;
+    RopSessionPool& operator =(const RopSessionPool&) = delete;
+
+    // replaces the keyring with a snapshot
+    void refresh(const RopSnapshot& snap);
+    // replaces the keyring with the keys of a session
+    void refresh(const RopSession& source);
+    // replaces the keyring with the keys read from an input
+    void refresh(const InString& format, const RopInput& input);
+    // waits for a free session
+    Lease lease();
+    size_t size() const noexcept { return count; }
+
+protected:
+    void Return(const Replica& replica) noexcept;
+
+    const RopBind bind;
+    const size_t count;
+    std::mutex lock;
+    std::condition_variable available;
+    std::vector<Replica> idle;
+    RopSnapshot keyring;
+    unsigned gen;
+};
+
 } CEROP_NAMESPACE_END
 
 #endif // ROP_SESSION_H
@@ -29,6 +29,7 @@
 #define ROP_SIGN_H
 
 #include "types.hpp"
+#include "error.hpp"
 
 
 CEROP_NAMESPACE_BEGIN {
@@ -52,6 +53,7 @@ public:
     Instant creation();
     RopString keyid();
     void is_valid();
+    RopResult<void> try_is_valid() noexcept;
     RopKey get_signer();
     RopData to_json(const bool mpi = false, const bool raw = false, const bool grip = false);
 
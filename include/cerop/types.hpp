@@ -31,6 +31,10 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <exception>
 #include <chrono>
 #include <ostream>
 #include <stdexcept>
@@ -55,13 +59,80 @@ typedef std::shared_ptr<RopObjectT> RopObject;
 typedef std::weak_ptr<RopObjectT> RopObjRef;
 typedef std::vector<RopObject> RopObjects;
 
-struct RopThrowedT {
-    std::exception_ptr ex;
-    bool handled;
-    inline RopThrowedT(const std::exception_ptr& ex) : ex(ex) { handled = false; }
+/**
+ * Bounded queue of exceptions raised in destructors, owned by each session
+ * and by the bind for objects created outside sessions. The next API call
+ * made on an object of the same session rethrows them, oldest first, so
+ * failures stay with the thread using that session. Exceptions arriving
+ * while the queue is full are dropped.
+ */
+class RopErrorQueueT final {
+public:
+    inline RopErrorQueueT() noexcept : head(0), count(0) {}
+    inline bool Pending() const noexcept { return count.load(std::memory_order_relaxed) != 0; }
+    inline size_t Size() const noexcept { return count.load(std::memory_order_relaxed); }
+    void Push(const std::exception_ptr& ex) noexcept;
+    std::exception_ptr Pop() noexcept;
+
+private:
+    static const size_t CAPACITY = 8;
+
+    std::mutex lock;
+    std::exception_ptr ring[CAPACITY];
+    size_t head;
+    std::atomic<size_t> count;
+};
+
+/**
+ * Size-class pool owned by a session. Wrappers created within the session
+ * are carved from its slabs; the slabs go back to the heap all at once
+ * when the session and the last of its wrappers are gone.
+ */
+class RopPoolT final {
+public:
+    RopPoolT() noexcept;
+    void* Allocate(const size_t size);
+    void Deallocate(void *const ptr, const size_t size) noexcept;
+    void Release() noexcept;
+
+private:
+    ~RopPoolT();
+
+    static const size_t GRAIN = 16;
+    static const size_t CLASSES = 32;
+    static const size_t SLAB = 8192;
+    struct Block { Block *next; };
+
+    std::mutex lock;
+    Block *freeList[CLASSES];
+    std::vector<void*> slabs;
+    char *cursor, *end;
+    size_t live;
+    bool released;
+};
+
+template<class T>
+struct RopPoolAlloc {
+    typedef T value_type;
+    inline explicit RopPoolAlloc(RopPoolT* pool) noexcept : pool(pool) {}
+    template<class U>
+    inline RopPoolAlloc(const RopPoolAlloc<U>& other) noexcept : pool(other.pool) {}
+    inline T* allocate(const size_t n) {
+        return static_cast<T*>(pool!=nullptr? pool->Allocate(n*sizeof(T)) : ::operator new(n*sizeof(T)));
+    }
+    inline void deallocate(T* ptr, const size_t n) noexcept {
+        if(pool != nullptr)
+            pool->Deallocate(ptr, n*sizeof(T));
+        else
+            ::operator delete(ptr);
+    }
+    template<class U>
+    inline bool operator ==(const RopPoolAlloc<U>& other) const noexcept { return pool == other.pool; }
+    template<class U>
+    inline bool operator !=(const RopPoolAlloc<U>& other) const noexcept { return pool != other.pool; }
+
+    RopPoolT *pool;
 };
-typedef std::shared_ptr<RopThrowedT> RopThrowed;
-typedef std::vector<RopThrowed> RopThrowList;
  
 class RopObjectT {
 public:
@@ -77,18 +148,33 @@ public:
 
 protected:
     RopObjectT(const RopObject& parent, const RopHandle handle = nullptr);
-    inline void FeedBack(const RopObject& obj, const std::shared_ptr<RopObjects>& depObjs = nullptr) noexcept { 
+    RopObjectT(RopObject&& parent, const RopHandle handle = nullptr) noexcept;
+    // allocates the object together with its reference counts, from the pool if any
+    template<class T, class... Args>
+    inline static std::shared_ptr<T> Make(RopPoolT* pool, Args&&... args) {
+        struct Made : public T {
+            inline Made(Args&&... args) : T(std::forward<Args>(args)...) {}
+        };
+        return std::allocate_shared<Made>(RopPoolAlloc<Made>(pool), std::forward<Args>(args)...);
+    }
+    inline void FeedBack(const RopObject& obj, const RopObject& dep0 = nullptr, const RopObject& dep1 = nullptr) noexcept { 
         me = obj; 
-        if(depObjs) deps = new RopObjects(*depObjs); 
+        if(dep0) deps[0] = dep0; 
+        if(dep1) deps[1] = dep1; 
     }
+    inline static RopObjectT* ParentOf(const RopObjectT* obj) noexcept { return obj!=nullptr? obj->parent.get() : nullptr; }
+    inline static RopErrorQueueT* QueueOf(const RopObjectT* obj) noexcept { return obj!=nullptr? obj->errq : nullptr; }
     void Attach(const RopHandle handle);
-    void ForwardException(const RopThrowed& thr);
+    void ForwardException(const std::exception_ptr& ex) noexcept;
 
     const RopObject parent;
     RopHandle handle;
     RopObjRef me;
-    RopObjects *deps;
-    RopThrowList *thl;
+    RopObject deps[2];  // objects the handle refers to, kept alive as long as it is
+    RopErrorQueueT *errq;
+    RopPoolT *pool;
+
+friend class Util;
 };
 
 
@@ -41,8 +41,8 @@ CEROP_NAMESPACE_BEGIN {
  */
 class Util final {
 public:
-    static RopString GetRopString(const RopObjRef& parent, const int ret, const char*const*const ropStr, const bool freeBuf = true);
-    static RopData GetRopData(const RopObjRef& parent, const int ret, const void*const ropBuf, const size_t bufLen, const bool freeBuf = true);
+    static RopString GetRopString(const RopObjectT& parent, const int ret, const char*const*const ropStr, const bool freeBuf = true);
+    static RopData GetRopData(const RopObjectT& parent, const int ret, const void*const ropBuf, const size_t bufLen, const bool freeBuf = true);
     inline static void CheckError(const unsigned ret) {
         if(ret != ROPE::SUCCESS)
             throw RopError(ret);
@@ -66,13 +66,19 @@ public:
 
 #define RET_ROP_OBJECT2(Type, hnd, FX, dps) \
     Util::CheckError(FX); \
-    Type obj = Type(new Type##T(me, hnd)); \
+    Type obj = Make<Type##T>(pool, me, hnd); \
     obj->FeedBack(obj, dps); \
     return obj
 #define RET_ROP_OBJECT(Type, hnd, FX) RET_ROP_OBJECT2(Type, hnd, FX, nullptr)
-#define DEPEND_LIST(...) std::shared_ptr<RopObjects>(new RopObjects {__VA_ARGS__})
-#define NEW_THROWED() RopThrowed(new RopThrowedT(std::current_exception()))
-#define API_PROLOG if(thl) ExceptionCheck();
+#define DEPEND_LIST(...) __VA_ARGS__
+#define NEW_THROWED() std::current_exception()
+#define TRY_PROLOG try {
+#define TRY_EPILOG } \
+    catch(const RopError& ex) { return RopFailure(ex.getErrCode()); } \
+    catch(const std::bad_alloc&) { return RopFailure(ROPE::ERROR_OUT_OF_MEMORY); } \
+    catch(const std::exception&) { return RopFailure(ROPE::ERROR_NOT_IMPLEMENTED); } \
+    catch(...) { return RopFailure(ROPE::ERROR_INTERNAL); }
+#define API_PROLOG if(errq!=nullptr && errq->Pending()) ExceptionCheck();
 
 } CEROP_NAMESPACE_END
 
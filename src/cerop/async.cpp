@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2020 Janky <box@janky.tech>
+ * All right reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @version 0.21
+ */
+
+#include "cerop/async.hpp"
+#include "cerop/session.hpp"
+
+
+CEROP_NAMESPACE_BEGIN {
+
+RopWorkerPool::RopWorkerPool(const size_t threads, const size_t maxQueued, const SessionFactory& factory) : 
+    maxQueued(maxQueued>0? maxQueued : 1), factory(factory), started(0), stopping(false) {
+    const size_t count = threads>0? threads : 1;
+    workers.reserve(count);
+    try {
+        for(size_t idx = 0; idx < count; idx++)
+            workers.push_back(std::thread(&RopWorkerPool::Run, this));
+        // fail here rather than hand tasks a missing session
+        std::unique_lock<std::mutex> guard(lock);
+        ready.wait(guard, [this] { return started == workers.size(); });
+        if(startError)
+            std::rethrow_exception(startError);
+    } catch(...) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        notEmpty.notify_all();
+        for(std::thread& worker : workers)
+            worker.join();
+        throw;
+    }
+}
+
+RopWorkerPool::~RopWorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    notFull.notify_all();
+    for(std::thread& worker : workers)
+        worker.join();
+}
+
+void RopWorkerPool::submit(const Task& task) {
+    std::unique_lock<std::mutex> guard(lock);
+    notFull.wait(guard, [this] { return tasks.size() < maxQueued || stopping; });
+    tasks.push_back(task);
+    guard.unlock();
+    notEmpty.notify_one();
+}
+
+bool RopWorkerPool::try_submit(const Task& task) {
+    std::unique_lock<std::mutex> guard(lock);
+    if(tasks.size() >= maxQueued)
+        return false;
+    tasks.push_back(task);
+    guard.unlock();
+    notEmpty.notify_one();
+    return true;
+}
+
+size_t RopWorkerPool::queued() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return tasks.size();
+}
+
+void RopWorkerPool::Run() {
+    RopSession ses;
+    std::exception_ptr error;
+    if(factory)
+        try {
+            ses = factory();
+        } catch(...) {
+            error = std::current_exception();
+        }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if(error && !startError)
+            startError = error;
+        started++;
+    }
+    ready.notify_all();
+    if(error)
+        return;
+    for(;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            notEmpty.wait(guard, [this] { return !tasks.empty() || stopping; });
+            if(tasks.empty())
+                break;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        notFull.notify_one();
+        try {
+            task(ses);
+        } catch(...) {}
+    }
+}
+
+void RopWorkerPool::Fulfil(std::promise<void>& done, const std::function<void(const RopSession&)>& fx, const RopSession& ses) {
+    try {
+        fx(ses);
+        done.set_value();
+    } catch(...) {
+        done.set_exception(std::current_exception());
+    }
+}
+
+} CEROP_NAMESPACE_END
@@ -30,7 +30,15 @@
  */
 
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 #include <stdexcept>
+#include <mutex>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <fcntl.h>
+#endif
 #include "load.h"
 #include "cerop/util.hpp"
 #include "cerop/error.hpp"
@@ -40,24 +48,137 @@
 CEROP_NAMESPACE_BEGIN {
 
 std::atomic_long RopBindT::instanceCnt(0);
+static std::mutex loadLock;
+// probed once per load, published to later binds through instanceCnt
+static uint32_t libCapabilities = 0;
+static bool libVersionOk = false;
+static uint64_t libTimestamp = 0;
+
+static const char *const capCore[] = { 
+    "rnp_version", "rnp_version_for", "rnp_version_commit_timestamp", "rnp_result_to_string", 
+    "rnp_ffi_create", "rnp_ffi_destroy", "rnp_load_keys", "rnp_unload_keys", "rnp_import_keys", "rnp_save_keys", 
+    "rnp_locate_key", "rnp_key_handle_destroy", "rnp_buffer_destroy", "rnp_buffer_clear", 
+    "rnp_input_from_path", "rnp_input_from_memory", "rnp_input_from_callback", "rnp_input_destroy", 
+    "rnp_output_to_path", "rnp_output_to_file", "rnp_output_to_memory", "rnp_output_to_callback", "rnp_output_to_null", 
+    "rnp_output_memory_get_buf", "rnp_output_finish", "rnp_output_destroy", 
+    "rnp_op_sign_create", "rnp_op_sign_execute", "rnp_op_sign_destroy", 
+    "rnp_op_verify_create", "rnp_op_verify_execute", "rnp_op_verify_destroy", 
+    "rnp_op_encrypt_create", "rnp_op_encrypt_execute", "rnp_op_encrypt_destroy", "rnp_decrypt", nullptr };
+static const char *const capAead[] = { "rnp_supports_feature", "rnp_op_encrypt_set_aead", "rnp_op_encrypt_set_aead_bits", "rnp_symenc_get_aead_alg", nullptr };
+static const char *const capSm2[] = { "rnp_supports_feature", "rnp_generate_key_sm2", nullptr };
+static const char *const capKeyValidity[] = { "rnp_key_is_valid", "rnp_key_valid_till", "rnp_uid_is_valid", nullptr };
+static const char *const capKeyProtection[] = { 
+    "rnp_key_get_protection_type", "rnp_key_get_protection_mode", "rnp_key_get_protection_cipher", 
+    "rnp_key_get_protection_hash", "rnp_key_get_protection_iterations", nullptr };
+static const char *const capRevocation[] = { 
+    "rnp_key_revoke", "rnp_key_export_revocation", "rnp_key_get_revocation_reason", 
+    "rnp_key_is_superseded", "rnp_key_is_compromised", "rnp_key_is_retired", nullptr };
+static const char *const capAutocrypt[] = { "rnp_key_export_autocrypt", nullptr };
+static const char *const capKeyRemoval[] = { "rnp_key_remove", nullptr };
+static const char *const capSigImport[] = { "rnp_import_signatures", nullptr };
+static const char *const capDecryptInfo[] = { 
+    "rnp_op_verify_get_protection_info", "rnp_op_verify_get_recipient_count", "rnp_op_verify_get_used_recipient", 
+    "rnp_op_verify_get_recipient_at", "rnp_op_verify_get_symenc_count", "rnp_op_verify_get_used_symenc", 
+    "rnp_op_verify_get_symenc_at", "rnp_recipient_get_keyid", "rnp_recipient_get_alg", "rnp_symenc_get_cipher", 
+    "rnp_symenc_get_hash_alg", "rnp_symenc_get_s2k_type", "rnp_symenc_get_s2k_iterations", nullptr };
+static const char *const capPassRequest[] = { "rnp_request_password", nullptr };
+static const char *const capArmorLine[] = { "rnp_output_armor_set_line_length", nullptr };
+
+static const struct {
+    RopBindT::Capability cap;
+    const char *const *symbols;
+    const char *featType;
+    const char *featName;
+} capDefs[] = {
+    { RopBindT::Capability::CORE, capCore, nullptr, nullptr },
+    { RopBindT::Capability::AEAD, capAead, "aead algorithm", "EAX" },
+    { RopBindT::Capability::SM2, capSm2, "public key algorithm", "SM2" },
+    { RopBindT::Capability::KEY_VALIDITY, capKeyValidity, nullptr, nullptr },
+    { RopBindT::Capability::KEY_PROTECTION_INFO, capKeyProtection, nullptr, nullptr },
+    { RopBindT::Capability::REVOCATION, capRevocation, nullptr, nullptr },
+    { RopBindT::Capability::AUTOCRYPT, capAutocrypt, nullptr, nullptr },
+    { RopBindT::Capability::KEY_REMOVAL, capKeyRemoval, nullptr, nullptr },
+    { RopBindT::Capability::SIGNATURE_IMPORT, capSigImport, nullptr, nullptr },
+    { RopBindT::Capability::DECRYPTION_INFO, capDecryptInfo, nullptr, nullptr },
+    { RopBindT::Capability::PASSWORD_REQUEST, capPassRequest, nullptr, nullptr },
+    { RopBindT::Capability::ARMOR_LINE_LENGTH, capArmorLine, nullptr, nullptr }
+};
+
+static uint32_t ProbeCapabilities() {
+    uint32_t caps = 0;
+    for(const auto& def : capDefs) {
+        bool found = true;
+        for(const char *const *sym = def.symbols; found && *sym != nullptr; sym++)
+            found = ROP_has_symbol(*sym) != 0;
+        if(found && def.featType != nullptr) {
+            bool supported = false;
+            found = CALL(rnp_supports_feature)(def.featType, def.featName, &supported) == ROPE::SUCCESS && supported;
+        }
+        if(found)
+            caps |= 1u << static_cast<unsigned>(def.cap);
+    }
+    return caps;
+}
+
+// the library stays loaded while any bind exists, only the first one loads and probes it
+void RopBindT::AcquireLib() {
+    long cnt = instanceCnt.load();
+    while(cnt > 0)
+        if(instanceCnt.compare_exchange_weak(cnt, cnt+1))
+            return;
+    std::lock_guard<std::mutex> lock(loadLock);
+    if(instanceCnt.load() == 0) {
+        ROP_load();
+        try {
+            libCapabilities = ProbeCapabilities();
+            libVersionOk = (libCapabilities & (1u << static_cast<unsigned>(Capability::CORE))) != 0;
+            libTimestamp = libVersionOk? CALL(rnp_version_commit_timestamp)() : 0;
+            libVersionOk = libVersionOk && CALL(rnp_version()) >= CALL(rnp_version_for(0, 9, 0));
+        } catch(...) {
+            ROP_unload();
+            throw;
+        }
+    }
+    instanceCnt++;
+}
+
+void RopBindT::ReleaseLib() {
+    if(--instanceCnt == 0) {
+        std::lock_guard<std::mutex> lock(loadLock);
+        if(instanceCnt.load() == 0)
+            ROP_unload();
+    }
+}
 
 RopBind RopBindT::New(const bool checkLibVer) {
-    ROP_load();
-    RopBindT *bind = new RopBindT();
-    RopBind pBind(bind);
-    bind->me = pBind;
-    if(pBind)
-        instanceCnt++;
+    AcquireLib();
+    RopBind pBind;
+    try {
+        pBind = Make<RopBindT>(nullptr, checkLibVer);
+    } catch(...) {
+        ReleaseLib();
+        throw;
+    }
+    pBind->FeedBack(pBind);
     return  pBind;
 }
 
+RopBind RopBindT::Shared(const bool checkLibVer) {
+    static RopBind shared(New(checkLibVer));
+    return shared;
+}
+
 RopBindT::RopBindT(const bool checkLibVer) : RopObjectT(RopObject()) {
-    if(checkLibVer && !(CALL(rnp_version()) >= CALL(rnp_version_for(0, 9, 0))) && !(CALL(rnp_version_commit_timestamp)() >= ropid()))
+    errq = &errors;
+    capabilities = libCapabilities;
+    if(checkLibVer && !libVersionOk && !(libTimestamp >= ropid()))
         throw RopError(ROPE::ERROR_LIBVERSION);
 }
 
 RopBindT::~RopBindT() {
-    instanceCnt--;
+    try {
+        ReleaseLib();
+    } catch(std::exception&) {}
 }
 
 static StringT altHome;
@@ -69,9 +190,9 @@ RopString RopBindT::default_homedir() { API_PROLOG
             altHome = StringT(getenv("HOMEDRIVE")) + getenv("HOMEPATH");
             altHome = altHome + (strchr(altHome.c_str(),'/')?"/":"\\") + ".rnp";
         }
-        return RopString(new RopStringT(me, altHome.c_str(), false));
+        return std::make_shared<RopStringT>(me, altHome.c_str(), false);
     }
-    return Util::GetRopString(me, err, &homedir);
+    return Util::GetRopString(*this, err, &homedir);
 }
 String RopBindT::version_string() { API_PROLOG
     const char *version = CALL(rnp_version_string)();
@@ -93,7 +214,7 @@ RopStrings RopBindT::get_homedir_info(const InString& homedir) { API_PROLOG
     RopStringsT *strs = new RopStringsT();
     strs->reserve(4);
     for(int idx = 0; idx < 4; idx++)
-        strs->push_back(Util::GetRopString(me, res, info+idx));
+        strs->push_back(Util::GetRopString(*this, res, info+idx));
     return RopStrings(strs);
 }
 uint32_t RopBindT::version_for(const uint32_t major, const uint32_t minor, const uint32_t patch) { API_PROLOG
@@ -124,11 +245,11 @@ bool RopBindT::supports_feature(const InString& type, const InString& name) { AP
 }
 RopString RopBindT::supported_features(const InString& type) { API_PROLOG
     char *result = nullptr;
-    return Util::GetRopString(me, CALL(rnp_supported_features)(type, &result), &result);
+    return Util::GetRopString(*this, CALL(rnp_supported_features)(type, &result), &result);
 }
 RopString RopBindT::detect_key_format(const RopDataT& buf) { API_PROLOG
     char *format = nullptr;
-    return Util::GetRopString(me, CALL(rnp_detect_key_format)(static_cast<const uint8_t*>(buf.getBuf()), buf.getLen(), &format), &format);
+    return Util::GetRopString(*this, CALL(rnp_detect_key_format)(static_cast<const uint8_t*>(buf.getBuf()), buf.getLen(), &format), &format);
 }
 size_t RopBindT::calculate_iterations(const InString& hash, const size_t msec) { API_PROLOG
     size_t iterations = 0;
@@ -158,6 +279,8 @@ RopInput RopBindT::create_input(const InString& path) { API_PROLOG
 
 bool input_reader(void *app_ctx, void *buf, size_t len, size_t *read) {
     RopInputT *inp = static_cast<RopInputT*>(app_ctx);
+    if(inp != nullptr && inp->fd >= 0)
+        return inp->ReadFd(buf, len, read);
     if(inp != nullptr && inp->inputCB != nullptr)
         return inp->inputCB->ReadCallBack(inp->inpcbCtx, buf, len, read);
     return 0;
@@ -168,13 +291,90 @@ void input_closer(void *app_ctx) {
         return inp->inputCB->RCloseCallBack(inp->inpcbCtx);
 }
 RopInput RopBindT::create_input(InputCallBack& inputCB, void* app_ctx) { API_PROLOG
-    RopInput inp = RopInput(new RopInputT(me, &inputCB, app_ctx));
+    RopInput inp = Make<RopInputT>(pool, me, &inputCB, app_ctx);
+    inp->FeedBack(inp);
+    rnp_input_t input = nullptr;
+    Util::CheckError(CALL(rnp_input_from_callback)(&input, reinterpret_cast<rnp_input_reader_t*>(input_reader), input_closer, inp.get()));
+    inp->Attach(input);
+    return inp;
+}
+void RopBindT::CheckFd(const int fd) {
+#if defined(_WIN32)
+    const bool open = fd >= 0 && _get_osfhandle(fd) != -1;
+#else
+    const bool open = fd >= 0 && fcntl(fd, F_GETFD) != -1;
+#endif
+    if(!open)
+        throw RopError(ROPE::ERROR_BAD_PARAMETERS);
+}
+RopInput RopBindT::create_input_fd(const int fd) { API_PROLOG
+    CheckFd(fd);
+    RopInput inp = Make<RopInputT>(pool, me, nullptr, nullptr);
+    inp->FeedBack(inp);
+    inp->fd = fd;
+    rnp_input_t input = nullptr;
+    Util::CheckError(CALL(rnp_input_from_callback)(&input, reinterpret_cast<rnp_input_reader_t*>(input_reader), input_closer, inp.get()));
+    inp->Attach(input);
+    return inp;
+}
+
+namespace {
+class SegmentSource : public InputCallBack {
+public:
+    inline SegmentSource(const RopIoVec* segs, const size_t count) : segs(segs, segs+count), idx(0), off(0) {}
+    virtual bool ReadCallBack(void *ctx, void *buf, size_t len, size_t *read) override {
+        uint8_t *dst = static_cast<uint8_t*>(buf);
+        size_t done = 0;
+        while(done < len && idx < segs.size()) {
+            if(segs[idx].len == 0) {
+                // the base of an empty segment may be null
+                idx++;
+                continue;
+            }
+            size_t part = std::min(segs[idx].len - off, len - done);
+            memcpy(dst + done, static_cast<const uint8_t*>(segs[idx].base) + off, part);
+            done += part;
+            off += part;
+            if(off == segs[idx].len) {
+                idx++;
+                off = 0;
+            }
+        }
+        if(read != nullptr)
+            *read = done;
+        return true;
+    }
+    virtual void RCloseCallBack(void *ctx) override {}
+private:
+    const std::vector<RopIoVec> segs;
+    size_t idx, off;
+};
+}
+
+RopInput RopBindT::create_input_source(const std::shared_ptr<InputCallBack>& source) {
+    RopInput inp = Make<RopInputT>(pool, me, source.get(), nullptr);
     inp->FeedBack(inp);
+    inp->source = source;
     rnp_input_t input = nullptr;
     Util::CheckError(CALL(rnp_input_from_callback)(&input, reinterpret_cast<rnp_input_reader_t*>(input_reader), input_closer, inp.get()));
     inp->Attach(input);
     return inp;
 }
+RopInput RopBindT::create_input(const RopIoVec* segs, const size_t count) { API_PROLOG
+    return create_input_source(std::make_shared<SegmentSource>(segs, count));
+}
+RopInput RopBindT::create_input_mmap(const InString& path) { API_PROLOG
+    RopInput inp = Make<RopInputT>(pool, me, nullptr, nullptr);
+    inp->FeedBack(inp);
+    inp->MapFile(path);
+    // some RNP versions reject an empty memory buffer, an empty file reads the same by path
+    if(inp->mapLen == 0)
+        return create_input(path);
+    rnp_input_t input = nullptr;
+    Util::CheckError(CALL(rnp_input_from_memory)(&input, static_cast<const uint8_t*>(inp->mapBuf), inp->mapLen, false));
+    inp->Attach(input);
+    return inp;
+}
 RopOutput RopBindT::create_output(const InString& toFile, const bool overwrite, const bool random) { API_PROLOG
     rnp_output_t output = nullptr;
     unsigned flags = (overwrite? RNP_OUTPUT_FILE_OVERWRITE : 0);
@@ -196,6 +396,8 @@ RopOutput RopBindT::create_output() { API_PROLOG
 
 bool output_writer(void *app_ctx, const void *buf, size_t len) {
     RopOutputT *outp = static_cast<RopOutputT*>(app_ctx);
+    if(outp != nullptr && outp->fd >= 0)
+        return outp->WriteFd(buf, len);
     if(outp != nullptr && outp->outputCB != nullptr)
         return outp->outputCB->WriteCallBack(outp->outpcbCtx, buf, len);
     return false;
@@ -206,18 +408,106 @@ void output_closer(void *app_ctx, bool discard) {
         outp->outputCB->WCloseCallBack(outp->outpcbCtx, discard);
 }
 RopOutput RopBindT::create_output(OutputCallBack& outputCB, void* app_ctx) { API_PROLOG
-    RopOutput outp = RopOutput(new RopOutputT(me, &outputCB, app_ctx));
+    RopOutput outp = Make<RopOutputT>(pool, me, &outputCB, app_ctx);
     outp->FeedBack(outp);
     rnp_output_t output = nullptr;
     Util::CheckError(CALL(rnp_output_to_callback)(&output, output_writer, output_closer, outp.get()));
     outp->Attach(output);
     return outp;
 }
+RopOutput RopBindT::create_output_fd(const int fd) { API_PROLOG
+    CheckFd(fd);
+    RopOutput outp = Make<RopOutputT>(pool, me, nullptr, nullptr);
+    outp->FeedBack(outp);
+    outp->fd = fd;
+    rnp_output_t output = nullptr;
+    Util::CheckError(CALL(rnp_output_to_callback)(&output, output_writer, output_closer, outp.get()));
+    outp->Attach(output);
+    return outp;
+}
+
+namespace {
+class VectorSink : public OutputCallBack {
+public:
+    inline VectorSink(std::vector<uint8_t>& buf) : buf(buf) {}
+    virtual bool WriteCallBack(void *ctx, const void *data, size_t len) override {
+        try {
+            buf.insert(buf.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data)+len);
+        } catch(std::exception&) {
+            return false;
+        }
+        return true;
+    }
+    virtual void WCloseCallBack(void *ctx, bool discard) override {}
+private:
+    std::vector<uint8_t>& buf;
+};
+
+class StringSink : public OutputCallBack {
+public:
+    inline StringSink(StringT& buf) : buf(buf) {}
+    virtual bool WriteCallBack(void *ctx, const void *data, size_t len) override {
+        try {
+            buf.append(static_cast<const char*>(data), len);
+        } catch(std::exception&) {
+            return false;
+        }
+        return true;
+    }
+    virtual void WCloseCallBack(void *ctx, bool discard) override {}
+private:
+    StringT& buf;
+};
+
+class BufferSink : public OutputCallBack {
+public:
+    inline BufferSink(void* buf, const size_t size, size_t* written) : buf(static_cast<uint8_t*>(buf)), size(size), fill(0), written(written) {
+        if(written != nullptr)
+            *written = 0;
+    }
+    virtual bool WriteCallBack(void *ctx, const void *data, size_t len) override {
+        if(len > size - fill)
+            return false;
+        memcpy(buf + fill, data, len);
+        fill += len;
+        if(written != nullptr)
+            *written = fill;
+        return true;
+    }
+    virtual void WCloseCallBack(void *ctx, bool discard) override {}
+private:
+    uint8_t *const buf;
+    const size_t size;
+    size_t fill;
+    size_t *const written;
+};
+}
+
+RopOutput RopBindT::create_output_sink(const std::shared_ptr<OutputCallBack>& sink) {
+    RopOutput outp = Make<RopOutputT>(pool, me, sink.get(), nullptr);
+    outp->FeedBack(outp);
+    outp->sink = sink;
+    rnp_output_t output = nullptr;
+    Util::CheckError(CALL(rnp_output_to_callback)(&output, output_writer, output_closer, outp.get()));
+    outp->Attach(output);
+    return outp;
+}
+RopOutput RopBindT::create_output_memory(std::vector<uint8_t>& buf) { API_PROLOG
+    return create_output_sink(std::make_shared<VectorSink>(buf));
+}
+RopOutput RopBindT::create_output_memory(StringT& buf) { API_PROLOG
+    return create_output_sink(std::make_shared<StringSink>(buf));
+}
+RopOutput RopBindT::create_output_memory(void* buf, const size_t size, size_t* written) { API_PROLOG
+    return create_output_sink(std::make_shared<BufferSink>(buf, size, written));
+}
+
 
 String RopBindT::toString() const {
     std::stringstream msg;
     msg << "use_count = " << me.use_count() << '\n' << "inst_count = " << instanceCnt << '\n';
-    msg << "thl = " << (thl!=nullptr? thl->size() : 0) << '\n';
+    msg << "errors = " << errors.Size() << '\n';
+    msg << "capabilities = " << std::hex << capabilities << std::dec << '\n';
     return String(new StringT(msg.str()));
 }
 
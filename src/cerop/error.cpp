@@ -29,8 +29,7 @@
  * @version 0.14.0
  */
 
-#include <string>
-#include <sstream>
+#include <cstdio>
 #include "load.h"
 #include "cerop/error.hpp"
 
@@ -39,9 +38,8 @@ CEROP_NAMESPACE_BEGIN {
 
 RopError::RopError(const unsigned errCode) noexcept {
     this->errCode = errCode;
-    std::stringstream msg;
-    msg << "ROP Error " << std::hex << errCode;
-    message = msg.str();
+    // formatted here, what() may be called from several threads at once
+    std::snprintf(message, sizeof(message), "ROP Error %x", errCode);
 }
 
 unsigned RopError::getErrCode() const {
@@ -49,7 +47,7 @@ unsigned RopError::getErrCode() const {
 }
 
 const char* RopError::what() const noexcept {
-    return message.c_str();
+    return message;
 }
 
 const unsigned ROPE::SUCCESS = RNP_SUCCESS;
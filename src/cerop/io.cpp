@@ -29,6 +29,23 @@
  * @version 0.14.0
  */
 
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 #include "load.h"
 #include "cerop/error.hpp"
 #include "cerop/util.hpp"
@@ -41,11 +58,19 @@ RopInputT::RopInputT(const RopObjRef& parent, const RopHandle iid) : RopObjectT(
     Attach(iid);
     inputCB = nullptr;
     inpcbCtx = nullptr;
+    mapBuf = nullptr;
+    mapLen = 0;
+    fd = -1;
+    fdUsed = false;
 }
 
 RopInputT::RopInputT(const RopObjRef& parent, InputCallBack* inputCB, void* app_ctx) : RopObjectT(parent.lock()) {
     this->inputCB = inputCB;
     this->inpcbCtx = app_ctx;
+    mapBuf = nullptr;
+    mapLen = 0;
+    fd = -1;
+    fdUsed = false;
 }
 
 RopInputT::~RopInputT() {
@@ -57,6 +82,127 @@ RopInputT::~RopInputT() {
         }
         handle = nullptr;
     }
+    UnmapFile();
+}
+
+static const uint8_t emptyMap[1] = { 0 };
+
+void RopInputT::MapFile(const char* path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        throw RopError(ROPE::ERROR_ACCESS);
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || static_cast<uint64_t>(size.QuadPart) > SIZE_MAX) {
+        CloseHandle(file);
+        throw RopError(ROPE::ERROR_READ);
+    }
+    const void *addr = emptyMap;
+    if(size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        addr = mapping!=nullptr? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if(mapping != nullptr)
+            CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if(addr == nullptr)
+        throw RopError(ROPE::ERROR_READ);
+    mapBuf = addr;
+    mapLen = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        throw RopError(ROPE::ERROR_ACCESS);
+    struct stat st;
+    if(fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) > SIZE_MAX) {
+        close(fd);
+        throw RopError(ROPE::ERROR_READ);
+    }
+    const void *addr = emptyMap;
+    if(st.st_size > 0) {
+        addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr == MAP_FAILED)
+            addr = nullptr;
+    }
+    close(fd);
+    if(addr == nullptr)
+        throw RopError(ROPE::ERROR_READ);
+    mapBuf = addr;
+    mapLen = static_cast<size_t>(st.st_size);
+    if(mapLen > 0)
+        posix_madvise(const_cast<void*>(mapBuf), mapLen, POSIX_MADV_SEQUENTIAL);
+#endif
+}
+
+bool RopInputT::ReadFd(void *buf, size_t len, size_t *read) noexcept {
+    fdUsed = true;
+    for(;;) {
+#if defined(_WIN32)
+        int ret = _read(fd, buf, static_cast<unsigned>(std::min<size_t>(len, INT_MAX)));
+#else
+        ssize_t ret = ::read(fd, buf, len);
+#endif
+        if(ret >= 0) {
+            if(read != nullptr)
+                *read = static_cast<size_t>(ret);
+            return true;
+        }
+        if(errno != EINTR)
+            return false;
+    }
+}
+
+/**
+ * Copies the rest of inFd to outFd inside the kernel.
+ * Returns false if no kernel path applies and nothing has been copied.
+ */
+bool RopInputT::PipeFd(const int inFd, const int outFd) {
+#if defined(__linux__)
+    enum { COPY_RANGE, SEND_FILE, SPLICE, NONE } how = COPY_RANGE;
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 27)
+    how = SEND_FILE;
+#endif
+    const size_t chunk = 1 << 30;
+    bool copied = false;
+    for(;;) {
+        ssize_t ret = -1;
+        switch(how) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+        case COPY_RANGE: ret = copy_file_range(inFd, nullptr, outFd, nullptr, chunk, 0); break;
+#endif
+        case SEND_FILE: ret = sendfile(outFd, inFd, nullptr, chunk); break;
+        case SPLICE: ret = splice(inFd, nullptr, outFd, nullptr, chunk, SPLICE_F_MOVE); break;
+        default: return false;
+        }
+        if(ret > 0)
+            copied = true;
+        else if(ret == 0) {
+            // some filesystems report 0 from copy_file_range before the end
+            if(copied || how != COPY_RANGE)
+                return true;
+            how = SEND_FILE;
+        } else if(errno == EINTR)
+            continue;
+        else if(!copied && (errno == EINVAL || errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EBADF))
+            how = (how == COPY_RANGE? SEND_FILE : how == SEND_FILE? SPLICE : NONE);
+        else
+            throw RopError(ROPE::ERROR_WRITE);
+    }
+#else
+    return false;
+#endif
+}
+
+void RopInputT::UnmapFile() noexcept {
+    if(mapBuf != nullptr && mapBuf != emptyMap) {
+#if defined(_WIN32)
+        UnmapViewOfFile(mapBuf);
+#else
+        munmap(const_cast<void*>(mapBuf), mapLen);
+#endif
+    }
+    mapBuf = nullptr;
+    mapLen = 0;
 }
 
 RopData RopInputT::dump_packets_to_json(const bool mpi, const bool raw, const bool grip) { API_PROLOG
@@ -65,7 +211,7 @@ RopData RopInputT::dump_packets_to_json(const bool mpi, const bool raw, const bo
     flags |= (grip? RNP_JSON_DUMP_GRIP : 0);
     char *result = nullptr;
     unsigned ret = CALL(rnp_dump_packets_to_json)(HCAST_INP(handle), flags, &result);
-    return Util::GetRopData(me, ret, result, Util::StrLen(result));
+    return Util::GetRopData(*this, ret, result, Util::StrLen(result));
 }
 void RopInputT::dump_packets_to_output(const RopOutput& output, const bool mpi, const bool raw, const bool grip) { API_PROLOG
     unsigned flags = (mpi? RNP_DUMP_MPI : 0);
@@ -81,9 +227,12 @@ void RopInputT::dearmor(const RopOutput& output) { API_PROLOG
 }
 RopString RopInputT::guess_contents() { API_PROLOG
     char *contents = nullptr;
-    return Util::GetRopString(me, CALL(rnp_guess_contents)(HCAST_INP(handle), &contents), &contents);
+    return Util::GetRopString(*this, CALL(rnp_guess_contents)(HCAST_INP(handle), &contents), &contents);
 }
 void RopInputT::output_pipe(const RopOutput& output) { API_PROLOG
+    // untouched descriptors on both sides are copied by the kernel
+    if(fd >= 0 && !fdUsed && output && output->fd >= 0 && !output->fdUsed && PipeFd(fd, output->fd))
+        return;
     Util::CheckError(CALL(rnp_output_pipe)(HCAST_INP(handle), HCAST_OUTP(output->getHandle())));
 }
 
@@ -91,11 +240,15 @@ RopOutputT::RopOutputT(const RopObjRef& parent, const RopHandle oid) : RopObject
     Attach(oid);
     outputCB = nullptr;
     outpcbCtx = nullptr;
+    fd = -1;
+    fdUsed = false;
 }
 
 RopOutputT::RopOutputT(const RopObjRef& parent, OutputCallBack* outputCB, void* app_ctx) : RopObjectT(parent.lock()) {
     this->outputCB = outputCB;
     this->outpcbCtx = app_ctx;
+    fd = -1;
+    fdUsed = false;
 }
 
 RopOutputT::~RopOutputT() {
@@ -119,16 +272,107 @@ RopData RopOutputT::memory_get_buf(const bool doCopy) { API_PROLOG
     uint8_t *buf = nullptr;
     size_t len = 0;
     unsigned ret = CALL(rnp_output_memory_get_buf)(HCAST_OUTP(handle), &buf, &len, doCopy);
-    return Util::GetRopData(me, ret, buf, len, doCopy);
+    return Util::GetRopData(*this, ret, buf, len, doCopy);
 }
 size_t RopOutputT::write(const RopDataT& data) { API_PROLOG
+    fdUsed = true;
     size_t written = 0;
     Util::CheckError(CALL(rnp_output_write)(HCAST_OUTP(handle), data.getBuf(), data.getLen(), &written));
     return written;
 }
 
+bool RopOutputT::WriteFd(const void *buf, size_t len) noexcept {
+    fdUsed = true;
+    const char *src = static_cast<const char*>(buf);
+    while(len > 0) {
+#if defined(_WIN32)
+        int ret = _write(fd, src, static_cast<unsigned>(std::min<size_t>(len, INT_MAX)));
+#else
+        ssize_t ret = ::write(fd, src, len);
+#endif
+        if(ret < 0) {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        src += ret;
+        len -= static_cast<size_t>(ret);
+    }
+    return true;
+}
+
 void RopOutputT::armor_set_line_length(const size_t llen) { API_PROLOG
     Util::CheckError(CALL(rnp_output_armor_set_line_length)(HCAST_OUTP(handle), llen));
 }
 
+
+BufferedInputCallBack::BufferedInputCallBack(InputCallBack& inputCB, const size_t chunkSize) : 
+    inputCB(inputCB), chunk(chunkSize>0? chunkSize : 1), pos(0), fill(0), eof(false) {}
+
+bool BufferedInputCallBack::ReadCallBack(void *ctx, void *buf, size_t len, size_t *read) {
+    // at most one read from the underlying callback, a short read is returned as is
+    size_t done = 0;
+    if(pos == fill && !eof && len > 0) {
+        size_t got = 0;
+        if(len >= chunk.size()) {
+            if(!inputCB.ReadCallBack(ctx, buf, len, &got))
+                return false;
+            done = got;
+        } else {
+            if(!inputCB.ReadCallBack(ctx, chunk.data(), chunk.size(), &got))
+                return false;
+            pos = 0;
+            fill = got;
+        }
+        eof = (got == 0);
+    }
+    if(done == 0 && pos < fill) {
+        done = std::min(fill-pos, len);
+        std::memcpy(buf, chunk.data()+pos, done);
+        pos += done;
+    }
+    if(read != nullptr)
+        *read = done;
+    return true;
+}
+
+void BufferedInputCallBack::RCloseCallBack(void *ctx) {
+    pos = fill = 0;
+    inputCB.RCloseCallBack(ctx);
+}
+
+BufferedOutputCallBack::BufferedOutputCallBack(OutputCallBack& outputCB, const size_t chunkSize) : 
+    outputCB(outputCB), chunk(chunkSize>0? chunkSize : 1), fill(0), flushFailed(false) {}
+
+bool BufferedOutputCallBack::WriteCallBack(void *ctx, const void *buf, size_t len) {
+    const uint8_t *src = static_cast<const uint8_t*>(buf);
+    if(fill+len > chunk.size() && !Flush(ctx))
+        return false;
+    if(len >= chunk.size()) {
+        if(!outputCB.WriteCallBack(ctx, src, len))
+            flushFailed = true;
+        return !flushFailed;
+    }
+    std::memcpy(chunk.data()+fill, src, len);
+    fill += len;
+    return true;
+}
+
+void BufferedOutputCallBack::WCloseCallBack(void *ctx, bool discard) {
+    if(!discard)
+        Flush(ctx);
+    fill = 0;
+    outputCB.WCloseCallBack(ctx, discard);
+}
+
+bool BufferedOutputCallBack::Flush(void *ctx) {
+    if(fill == 0)
+        return true;
+    const size_t len = fill;
+    fill = 0;
+    if(!outputCB.WriteCallBack(ctx, chunk.data(), len))
+        flushFailed = true;
+    return !flushFailed;
+}
+
 } CEROP_NAMESPACE_END
@@ -29,10 +29,14 @@
  * @version 0.14.0
  */
 
+#include <cstring>
+#include <algorithm>
 #include "load.h"
 #include "cerop/error.hpp"
 #include "cerop/util.hpp"
 #include "cerop/key.hpp"
+#include "cerop/session.hpp"
+#include "cerop/bind.hpp"
 
 
 CEROP_NAMESPACE_BEGIN {
@@ -60,7 +64,7 @@ RopData RopUidHandleT::get_data() { API_PROLOG
     uint8_t *buf = nullptr;
     size_t buf_len = 0;
     unsigned ret = CALL(rnp_uid_get_data)(HCAST_UID(handle), reinterpret_cast<void**>(&buf), &buf_len);
-    return Util::GetRopData(me, ret, buf, buf_len);
+    return Util::GetRopData(*this, ret, buf, buf_len);
 }
 bool RopUidHandleT::is_primary() { API_PROLOG
     bool result = false;
@@ -104,7 +108,7 @@ RopKeyT::~RopKeyT() {
 
 #define RET_KEY_STRING(nm, fx) \
     char *nm = nullptr; \
-    return Util::GetRopString(me, CALL(fx)(HCAST_KEY(handle), &nm), &nm)
+    return Util::GetRopString(*this, CALL(fx)(HCAST_KEY(handle), &nm), &nm)
 #define RET_KEY_PRIM(type, nm, def, fx) \
     type nm = def; \
     return Util::GetPrimVal<type>(CALL(fx)(HCAST_KEY(handle), &nm), &nm)
@@ -140,6 +144,7 @@ RopString RopKeyT::revocation_reason() { API_PROLOG
     RET_KEY_STRING(result, rnp_key_get_revocation_reason);
 }
 void RopKeyT::set_expiration(const Duration& expiry) { API_PROLOG
+    Edited();
     Util::CheckError(CALL(rnp_key_set_expiration)(HCAST_KEY(handle), Util::TimeDelta2Sec(expiry)));
 }
 bool RopKeyT::is_valid() { API_PROLOG
@@ -227,7 +232,7 @@ size_t RopKeyT::subkey_count() { API_PROLOG
 }
 RopString RopKeyT::get_uid_at(const size_t idx) { API_PROLOG
     char *uid = nullptr;
-    return Util::GetRopString(me, CALL(rnp_key_get_uid_at)(HCAST_KEY(handle), idx, &uid), &uid);
+    return Util::GetRopString(*this, CALL(rnp_key_get_uid_at)(HCAST_KEY(handle), idx, &uid), &uid);
 }
 RopData RopKeyT::to_json(const bool publicMpis, const bool secretMpis, const bool signatures, const bool signMpis) { API_PROLOG
     unsigned flags = (publicMpis? RNP_JSON_PUBLIC_MPIS : 0);
@@ -236,7 +241,7 @@ RopData RopKeyT::to_json(const bool publicMpis, const bool secretMpis, const boo
     flags |= (signMpis? RNP_JSON_SIGNATURE_MPIS : 0);
     char *result = nullptr;
     unsigned ret = CALL(rnp_key_to_json)(HCAST_KEY(handle), flags, &result);
-    return Util::GetRopData(me, ret, result, Util::StrLen(result));
+    return Util::GetRopData(*this, ret, result, Util::StrLen(result));
 }
 RopData RopKeyT::packets_to_json(const bool secret, const bool mpi, const bool raw, const bool grip) { API_PROLOG
     unsigned flags = (mpi? RNP_JSON_DUMP_MPI : 0);
@@ -244,7 +249,7 @@ RopData RopKeyT::packets_to_json(const bool secret, const bool mpi, const bool r
     flags |= (grip? RNP_JSON_DUMP_GRIP : 0);
     char *result = nullptr;
     unsigned ret = CALL(rnp_key_packets_to_json)(HCAST_KEY(handle), secret, flags, &result);
-    return Util::GetRopData(me, ret, result, Util::StrLen(result));
+    return Util::GetRopData(*this, ret, result, Util::StrLen(result));
 }
 bool RopKeyT::allows_usage(const InString& usage) { API_PROLOG
     bool result = false; \
@@ -263,9 +268,11 @@ bool RopKeyT::disallows_usages(const StringsT& usages) { API_PROLOG
     return true;
 }
 void RopKeyT::lock() { API_PROLOG
+    Edited();
     Util::CheckError(CALL(rnp_key_lock)(HCAST_KEY(handle)));
 }
 void RopKeyT::unlock(const InString& password) { API_PROLOG
+    Edited();
     Util::CheckError(CALL(rnp_key_unlock)(HCAST_KEY(handle), password));
 }
 RopUidHandle RopKeyT::get_uid_handle_at(const size_t idx) { API_PROLOG
@@ -273,24 +280,27 @@ RopUidHandle RopKeyT::get_uid_handle_at(const size_t idx) { API_PROLOG
     RET_ROP_OBJECT(RopUidHandle, uid, CALL(rnp_key_get_uid_handle_at)(HCAST_KEY(handle), idx, &uid));
 }
 void RopKeyT::protect(const InString& password, const InString& cipher, const InString& cipherMode, const InString& hash, const size_t iterations) { API_PROLOG
+    Edited();
     Util::CheckError(CALL(rnp_key_protect)(HCAST_KEY(handle), password, cipher, cipherMode, hash, iterations));
 }
 void RopKeyT::unprotect(const InString& password) { API_PROLOG
+    Edited();
     Util::CheckError(CALL(rnp_key_unprotect)(HCAST_KEY(handle), password));
 }
 RopData RopKeyT::public_key_data() { API_PROLOG
     uint8_t *buf = nullptr;
     size_t buf_len = 0;
     unsigned ret = CALL(rnp_get_public_key_data)(HCAST_KEY(handle), &buf, &buf_len);
-    return Util::GetRopData(me, ret, buf, buf_len);
+    return Util::GetRopData(*this, ret, buf, buf_len);
 }
 RopData RopKeyT::secret_key_data() { API_PROLOG
     uint8_t *buf = nullptr;
     size_t buf_len = 0;
     unsigned ret = CALL(rnp_get_secret_key_data)(HCAST_KEY(handle), &buf, &buf_len);
-    return Util::GetRopData(me, ret, buf, buf_len);
+    return Util::GetRopData(*this, ret, buf, buf_len);
 }
 void RopKeyT::add_uid(const InString& uid, const InString& hash, const Instant& expiration, const uint8_t keyFlags, const bool primary) { API_PROLOG
+    Edited();
     Util::CheckError(CALL(rnp_key_add_uid)(HCAST_KEY(handle), uid, hash, Util::Datetime2TS(expiration), keyFlags, primary));
 }
 RopKey RopKeyT::get_subkey_at(const size_t idx) { API_PROLOG
@@ -323,13 +333,95 @@ void RopKeyT::export_revocation(const RopOutput& output, const InString& hash, c
     Util::CheckError(CALL(rnp_key_export_revocation)(HCAST_KEY(handle), HCAST_OUTP(outp), 0, hash, code, reason));
 }
 void RopKeyT::revoke(const InString& hash, const InString& code, const InString& reason) { API_PROLOG
+    Edited();
     Util::CheckError(CALL(rnp_key_revoke)(HCAST_KEY(handle), 0, hash, code, reason));
 }
+RopKeySnapshotT RopKeyT::snapshot() { API_PROLOG
+    RopKeySnapshotT snap = RopKeySnapshotT();
+    RopSessionT *ses = RopSessionT::SessionOf(this);
+    Snapshot(handle, snap, ses != nullptr && ses->getBind()->has(RopBindT::Capability::KEY_VALIDITY));
+    return snap;
+}
+/**
+ * Copies a string returned by RNP into a fixed buffer and releases it,
+ * the buffer is left empty if the call failed. A longer string is cut
+ * before the UTF-8 character that does not fit.
+ */
+template<size_t N>
+static void CopyKeyString(const unsigned ret, char* str, char (&dst)[N]) {
+    size_t len = 0;
+    if(ret == ROPE::SUCCESS && str != nullptr) {
+        len = std::min(std::strlen(str), N-1);
+        while(len > 0 && (static_cast<unsigned char>(str[len]) & 0xC0) == 0x80)
+            len--;
+        std::memcpy(dst, str, len);
+    }
+    dst[len] = '\0';
+    if(str != nullptr)
+        CALL(rnp_buffer_destroy)(str);
+}
+void RopKeyT::Snapshot(const RopHandle handle, RopKeySnapshotT& snap, const bool validity) {
+    rnp_key_handle_t key = HCAST_KEY(handle);
+    char *str = nullptr;
+    unsigned ret = CALL(rnp_key_get_keyid)(key, &str);
+    CopyKeyString(ret, str, snap.keyid);
+    Util::CheckError(ret);
+    ret = CALL(rnp_key_get_fprint)(key, &(str = nullptr));
+    CopyKeyString(ret, str, snap.fprint);
+    Util::CheckError(ret);
+    ret = CALL(rnp_key_get_alg)(key, &(str = nullptr));
+    CopyKeyString(ret, str, snap.alg);
+    Util::CheckError(ret);
+    // optional fields, left empty when the key has none
+    ret = CALL(rnp_key_get_grip)(key, &(str = nullptr));
+    CopyKeyString(ret, str, snap.grip);
+    ret = CALL(rnp_key_get_primary_fprint)(key, &(str = nullptr));
+    CopyKeyString(ret, str, snap.primaryFprint);
+    ret = CALL(rnp_key_get_curve)(key, &(str = nullptr));
+    CopyKeyString(ret, str, snap.curve);
+    ret = CALL(rnp_key_get_primary_uid)(key, &(str = nullptr));
+    CopyKeyString(ret, str, snap.primaryUid);
+
+    uint32_t val = 0;
+    Util::CheckError(CALL(rnp_key_get_bits)(key, &val));
+    snap.bits = val;
+    Util::CheckError(CALL(rnp_key_get_creation)(key, &(val = 0)));
+    snap.creation = Instant(Duration(val));
+    Util::CheckError(CALL(rnp_key_get_expiration)(key, &(val = 0)));
+    snap.expiration = Duration(val);
+    Util::CheckError(CALL(rnp_key_get_uid_count)(key, &(snap.uidCount = 0)));
+    Util::CheckError(CALL(rnp_key_get_subkey_count)(key, &(snap.subkeyCount = 0)));
+    Util::CheckError(CALL(rnp_key_get_signature_count)(key, &(snap.signatureCount = 0)));
+    Util::CheckError(CALL(rnp_key_is_primary)(key, &(snap.primary = false)));
+    snap.validTill = Instant();
+    snap.valid = false;
+    if(validity) {
+        Util::CheckError(CALL(rnp_key_valid_till)(key, &(val = 0)));
+        snap.validTill = val==0? Instant::min() : (val==0xffffffffl? Instant::max() : Instant(Duration(val)));
+        Util::CheckError(CALL(rnp_key_is_valid)(key, &snap.valid));
+    }
+    Util::CheckError(CALL(rnp_key_is_revoked)(key, &(snap.revoked = false)));
+    Util::CheckError(CALL(rnp_key_have_secret)(key, &(snap.haveSecret = false)));
+    Util::CheckError(CALL(rnp_key_have_public)(key, &(snap.havePublic = false)));
+    snap.isProtected = snap.locked = false;
+    if(snap.haveSecret) {
+        Util::CheckError(CALL(rnp_key_is_protected)(key, &snap.isProtected));
+        Util::CheckError(CALL(rnp_key_is_locked)(key, &snap.locked));
+    }
+}
+void RopKeyT::Edited() noexcept {
+    RopSessionT *ses = RopSessionT::SessionOf(this);
+    if(ses != nullptr)
+        ses->keyEdits++;
+}
 void RopKeyT::remove(const bool pub, const bool sec, const bool sub) { API_PROLOG
     unsigned flags = (pub? RNP_KEY_REMOVE_PUBLIC : 0);
     flags |= (sec? RNP_KEY_REMOVE_SECRET : 0);
     flags |= (sub? RNP_KEY_REMOVE_SUBKEYS : 0);
     Util::CheckError(CALL(rnp_key_remove(HCAST_KEY(handle), flags)));
+    RopSessionT *ses = RopSessionT::SessionOf(this);
+    if(ses != nullptr)
+        ses->InvalidateKeys();
 }
 
 } CEROP_NAMESPACE_END
@@ -0,0 +1,366 @@
+/**
+ * Copyright (c) 2020 Janky <box@janky.tech>
+ * All right reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @version 0.21
+ */
+
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <exception>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+#include "cerop/error.hpp"
+#include "cerop/util.hpp"
+#include "cerop/bind.hpp"
+#include "cerop/keyindex.hpp"
+
+
+CEROP_NAMESPACE_BEGIN {
+
+static const char indexMagic[8] = { 'C', 'E', 'R', 'O', 'P', 'I', 'D', 'X' };
+static const uint32_t indexVersion = 1;
+static const uint32_t indexOrder = 0x01020304;
+static const char *const indexTypes[] = { "keyid", "fingerprint", "grip", "userid", nullptr };
+
+bool RopKeyIndex::split_keys(const uint8_t* data, const size_t len, std::vector<std::pair<size_t, size_t>>& keys) {
+    size_t pos = 0, start = len;
+    while(pos < len) {
+        const uint8_t hdr = data[pos];
+        if((hdr & 0x80) == 0)
+            return false;
+        unsigned tag = 0;
+        size_t hlen = 0, plen = 0;
+        if(hdr & 0x40) {
+            tag = hdr & 0x3f;
+            if(pos+2 > len)
+                return false;
+            const uint8_t l0 = data[pos+1];
+            if(l0 < 192) {
+                hlen = 2;
+                plen = l0;
+            } else if(l0 < 224) {
+                if(pos+3 > len)
+                    return false;
+                hlen = 3;
+                plen = ((l0-192) << 8) + data[pos+2] + 192;
+            } else if(l0 == 255) {
+                if(pos+6 > len)
+                    return false;
+                hlen = 6;
+                plen = (size_t(data[pos+2]) << 24) | (size_t(data[pos+3]) << 16) | (size_t(data[pos+4]) << 8) | data[pos+5];
+            } else
+                return false;  // partial lengths are not used by key packets
+        } else {
+            tag = (hdr >> 2) & 0x0f;
+            const unsigned ltype = hdr & 0x03;
+            if(ltype == 3) {
+                hlen = 1;
+                plen = len - pos - 1;
+            } else {
+                const size_t lbytes = size_t(1) << ltype;
+                if(pos+1+lbytes > len)
+                    return false;
+                hlen = 1 + lbytes;
+                for(size_t idx = 0; idx < lbytes; idx++)
+                    plen = (plen << 8) | data[pos+1+idx];
+            }
+        }
+        if(plen > len - pos - hlen)
+            return false;
+        if(tag == 5 || tag == 6) {
+            if(start < len)
+                keys.push_back(std::make_pair(start, pos - start));
+            start = pos;
+        }
+        pos += hlen + plen;
+    }
+    if(start < len)
+        keys.push_back(std::make_pair(start, len - start));
+    return true;
+}
+
+static uint64_t Hash(const char* type, const char* identifier) {
+    // FNV-1a over the type and the identifier, hex identifiers in upper case
+    const bool hex = std::strcmp(type, "userid") != 0;
+    uint64_t hash = 14695981039346656037ULL;
+    for(const char *chr = type; *chr; chr++)
+        hash = (hash ^ static_cast<uint8_t>(*chr)) * 1099511628211ULL;
+    hash = (hash ^ 0) * 1099511628211ULL;
+    for(const char *chr = identifier; *chr; chr++) {
+        const uint8_t val = static_cast<uint8_t>(hex? std::toupper(static_cast<uint8_t>(*chr)) : *chr);
+        hash = (hash ^ val) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Loads every key of a binary keyring alone into a scratch session and
+ * reports the hash of each of its identifiers with the key byte range.
+ */
+static bool ScanKeys(const RopBind& bind, const uint8_t* data, const size_t len, const std::function<void(uint64_t, size_t, size_t)>& found) {
+    std::vector<std::pair<size_t, size_t>> keys;
+    if(!RopKeyIndex::split_keys(data, len, keys))
+        return false;
+    RopSession scratch = bind->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    for(const std::pair<size_t, size_t>& key : keys) {
+        scratch->load_keys(RopBindT::KEYSTORE_GPG, bind->create_input(RopDataT(data + key.first, key.second), false));
+        for(const char *const *type = indexTypes; *type != nullptr; type++) {
+            RopIdIterator it = scratch->identifier_iterator_create(*type);
+            for(RopString id = it->next(); id; id = it->next())
+                found(Hash(*type, *id), key.first, key.second);
+        }
+        scratch->unload_keys();
+    }
+    return true;
+}
+
+void RopKeyIndex::build(const RopBind& bind, const InString& keyring, const InString& index) {
+    RopInput ring = bind->create_input_mmap(keyring);
+    std::vector<Entry> entries;
+    if(!ScanKeys(bind, static_cast<const uint8_t*>(ring->mapBuf), ring->mapLen, [&entries](uint64_t hash, size_t offset, size_t length) {
+        Entry entry = { hash, offset, length };
+        entries.push_back(entry);
+    }))
+        throw RopError(ROPE::ERROR_BAD_FORMAT);
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { 
+        return a.hash < b.hash || (a.hash == b.hash && a.offset < b.offset); 
+    });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { 
+        return a.hash == b.hash && a.offset == b.offset; 
+    }), entries.end());
+
+    Header header;
+    std::memcpy(header.magic, indexMagic, sizeof(header.magic));
+    header.version = indexVersion;
+    header.order = indexOrder;
+    header.count = entries.size();
+    std::ofstream out(static_cast<const char*>(index), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(!entries.empty())
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    out.close();
+    if(!out)
+        throw RopError(ROPE::ERROR_WRITE);
+}
+
+RopKeyIndex::RopKeyIndex(const RopBind& bind, const InString& keyring, const InString& index) : bind(bind), entries(nullptr), count(0) {
+    ring = bind->create_input_mmap(keyring);
+    this->index = bind->create_input_mmap(index);
+    const Header *header = static_cast<const Header*>(this->index->mapBuf);
+    if(this->index->mapLen < sizeof(Header) || std::memcmp(header->magic, indexMagic, sizeof(indexMagic)) != 0 || 
+        header->version != indexVersion || header->order != indexOrder || 
+        header->count > (this->index->mapLen - sizeof(Header)) / sizeof(Entry))
+        throw RopError(ROPE::ERROR_BAD_FORMAT);
+    entries = reinterpret_cast<const Entry*>(header + 1);
+    count = static_cast<size_t>(header->count);
+}
+
+bool RopKeyIndex::load_key(const RopSession& ses, const InString& identifier_type, const InString& identifier) {
+    const char *type = identifier_type, *id = identifier;
+    if(type == nullptr || id == nullptr)
+        return false;
+    const uint64_t hash = Hash(type, id);
+    const Entry *end = entries + count;
+    const Entry *match = std::lower_bound(entries, end, hash, [](const Entry& entry, const uint64_t val) { return entry.hash < val; });
+    bool found = false;
+    const uint8_t *data = static_cast<const uint8_t*>(ring->mapBuf);
+    for(; match != end && match->hash == hash; match++) {
+        if(match->offset > ring->mapLen || match->length > ring->mapLen - match->offset)
+            continue;
+        ses->load_keys(RopBindT::KEYSTORE_GPG, bind->create_input(RopDataT(data + match->offset, static_cast<size_t>(match->length)), false));
+        found = true;
+    }
+    return found;
+}
+
+size_t RopKeyIndex::size() const noexcept {
+    return count;
+}
+
+void RopKeyIndex::KeyCallBack(const RopSession& ses, void* ctx, const InString& identifier_type, const InString& identifier, const bool secret) {
+    load_key(ses, identifier_type, identifier);
+}
+
+KeyringKeyProvider::KeyringKeyProvider(const RopBind& bind) : bind(bind) {}
+
+void KeyringKeyProvider::add(const InString& path) {
+    const char *dir = path;
+#if defined(_WIN32)
+    const DWORD attrs = GetFileAttributesA(dir);
+    if(attrs == INVALID_FILE_ATTRIBUTES)
+        throw RopError(ROPE::ERROR_ACCESS);
+    if((attrs & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        AddFile(dir);
+        return;
+    }
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA((StringT(dir) + "\\*").c_str(), &entry);
+    if(find == INVALID_HANDLE_VALUE)
+        throw RopError(ROPE::ERROR_ACCESS);
+    std::vector<StringT> names;
+    do {
+        if((entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            names.push_back(StringT(dir) + "\\" + entry.cFileName);
+    } while(FindNextFileA(find, &entry));
+    FindClose(find);
+#else
+    struct stat st;
+    if(stat(dir, &st) != 0)
+        throw RopError(ROPE::ERROR_ACCESS);
+    if(!S_ISDIR(st.st_mode)) {
+        AddFile(dir);
+        return;
+    }
+    DIR *find = opendir(dir);
+    if(find == nullptr)
+        throw RopError(ROPE::ERROR_ACCESS);
+    std::vector<StringT> names;
+    for(struct dirent *entry = readdir(find); entry != nullptr; entry = readdir(find)) {
+        const StringT name = StringT(dir) + "/" + entry->d_name;
+        if(stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+            names.push_back(name);
+    }
+    closedir(find);
+#endif
+    // directory order is arbitrary, keep loading deterministic
+    std::sort(names.begin(), names.end());
+    for(const StringT& name : names)
+        AddFile(name.c_str());
+}
+
+void KeyringKeyProvider::AddFile(const char* path) {
+    RopInput file = bind->create_input_mmap(path);
+    const size_t fileNo = files.size();
+    std::unordered_map<size_t, size_t> slots;
+    if(!ScanKeys(bind, static_cast<const uint8_t*>(file->mapBuf), file->mapLen, [&](uint64_t hash, size_t offset, size_t length) {
+        auto slot = slots.find(offset);
+        if(slot == slots.end()) {
+            Slot key = { fileNo, offset, length };
+            keys.push_back(key);
+            slot = slots.insert(std::make_pair(offset, keys.size()-1)).first;
+        }
+        ids.insert(std::make_pair(hash, slot->second));
+    }))
+        throw RopError(ROPE::ERROR_BAD_FORMAT);
+    files.push_back(file);
+}
+
+bool KeyringKeyProvider::load_key(const RopSession& ses, const InString& identifier_type, const InString& identifier) {
+    const char *type = identifier_type, *id = identifier;
+    if(type == nullptr || id == nullptr)
+        return false;
+    auto range = ids.equal_range(Hash(type, id));
+    if(range.first == range.second)
+        return false;
+    for(auto match = range.first; match != range.second; match++) {
+        const Slot& key = keys[match->second];
+        const uint8_t *data = static_cast<const uint8_t*>(files[key.file]->mapBuf);
+        ses->load_keys(RopBindT::KEYSTORE_GPG, bind->create_input(RopDataT(data + key.offset, key.length), false));
+    }
+    return true;
+}
+
+size_t KeyringKeyProvider::size() const noexcept {
+    return keys.size();
+}
+
+void KeyringKeyProvider::KeyCallBack(const RopSession& ses, void* ctx, const InString& identifier_type, const InString& identifier, const bool secret) {
+    load_key(ses, identifier_type, identifier);
+}
+
+RopKeyShards::RopKeyShards(const RopBind& bind, const InString& keyring, const size_t threads) : bind(bind) {
+    ring = bind->create_input_mmap(keyring);
+    const uint8_t *data = static_cast<const uint8_t*>(ring->mapBuf);
+    std::vector<std::pair<size_t, size_t>> keys;
+    if(!RopKeyIndex::split_keys(data, ring->mapLen, keys))
+        throw RopError(ROPE::ERROR_BAD_FORMAT);
+
+    size_t count = threads > 0? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    count = std::max<size_t>(std::min(count, keys.size()), 1);
+    // contiguous byte ranges cut at the first key boundary past each share
+    std::vector<RopInput> parts;
+    size_t first = 0;
+    for(size_t idx = 1; idx <= count; idx++) {
+        const size_t target = ring->mapLen / count * idx;
+        size_t last = first;
+        while(last < keys.size() && (idx == count || keys[last].first < target))
+            last++;
+        if(last == first)
+            continue;
+        const size_t start = keys[first].first;
+        const size_t end = last < keys.size()? keys[last].first : ring->mapLen;
+        shards.push_back(bind->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG));
+        parts.push_back(bind->create_input(RopDataT(data + start, end - start), false));
+        first = last;
+    }
+
+    std::vector<std::exception_ptr> errors(shards.size());
+    std::vector<std::thread> workers;
+    workers.reserve(shards.size());
+    try {
+        for(size_t idx = 0; idx < shards.size(); idx++) {
+            workers.push_back(std::thread([this, &parts, &errors, idx]() {
+                try {
+                    shards[idx]->load_keys(RopBindT::KEYSTORE_GPG, parts[idx]);
+                } catch(...) {
+                    errors[idx] = std::current_exception();
+                }
+            }));
+        }
+    } catch(...) {
+        // joinable threads must not be destroyed
+        for(std::thread& worker : workers)
+            worker.join();
+        throw;
+    }
+    for(std::thread& worker : workers)
+        worker.join();
+    for(const std::exception_ptr& error : errors)
+        if(error)
+            std::rethrow_exception(error);
+}
+
+RopKey RopKeyShards::locate_key(const InString& identifier_type, const InString& identifier) {
+    for(const RopSession& ses : shards) {
+        RopResult<RopKey> key = ses->try_locate_key(identifier_type, identifier);
+        if(key)
+            return *key;
+    }
+    return RopKey();
+}
+
+} CEROP_NAMESPACE_END
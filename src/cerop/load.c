@@ -26,7 +26,7 @@
  */
 
 /**
- * @version 0.2.1
+ * @version 0.2.2
  */
 
 #include <stdlib.h>
@@ -39,32 +39,59 @@ extern "C" {
 void ThrowMissingLibrary(const char* libName, const char* err);
 void ThrowMissingMethod(const char* metName, const char* err);
 
+#ifdef ROP_LOAD_EAGER
+    static void RopUnbindSyms(void);
+#else
+    #define RopUnbindSyms()
+#endif
+
 #if defined(_WIN32) && defined(_MSC_VER)
     #include <stdio.h>
     #include <Windows.h>
     #define ROP_LIB_NAME "librnp-0.dll"
     static HMODULE hlib = NULL;
+    static SRWLOCK hlock = SRWLOCK_INIT;
+
+    #define ROP_LOCK() AcquireSRWLockExclusive(&hlock)
+    #define ROP_UNLOCK() ReleaseSRWLockExclusive(&hlock)
+    #define ROP_ACQUIRE(ptr) ReadPointerAcquire((PVOID const volatile*)&(ptr))
+    #define ROP_RELEASE(ptr, val) WritePointerRelease((PVOID volatile*)&(ptr), (PVOID)(val))
 
 #ifdef ROP_LOAD_STATIC
     static
 #endif
     void on_attach() {
+        HMODULE lib = NULL;
+        char buf[0x20];
+        ROP_LOCK();
         if (hlib == NULL)
             hlib = LoadLibrary(TEXT(ROP_LIB_NAME));
-        if (hlib == NULL) {
-            char buf[0x20]; snprintf(buf, sizeof(buf), "Error %08X", GetLastError());
+        if ((lib = hlib) == NULL)
+            snprintf(buf, sizeof(buf), "Error %08X", GetLastError());
+        ROP_UNLOCK();
+        if (lib == NULL)
             ThrowMissingLibrary(ROP_LIB_NAME, buf);
-        }
     }
 
 #ifdef ROP_LOAD_STATIC
     static
 #endif
-    void on_detach() { if (hlib != NULL) FreeLibrary(hlib); hlib = NULL; }
+    void on_detach() { 
+        ROP_LOCK();
+        RopUnbindSyms();
+        if (hlib != NULL) FreeLibrary(hlib); 
+        hlib = NULL;
+        ROP_UNLOCK();
+    }
 
+    static void* RopDlLookup(const char* symbol) {
+        return hlib != NULL? GetProcAddress(hlib, symbol) : NULL;
+    }
+
+#ifndef ROP_LOAD_EAGER
     static void* RopDlSym(const char* symbol) {
         if (hlib != NULL) {
-            void* ptr = GetProcAddress(hlib, symbol);
+            void* ptr = RopDlLookup(symbol);
             if (ptr == NULL) {
                 char buf[0x20]; snprintf(buf, sizeof(buf), "Error %08X", GetLastError());
                 ThrowMissingMethod(symbol, buf);
@@ -73,6 +100,7 @@ void ThrowMissingMethod(const char* metName, const char* err);
         }
         return NULL;
     }
+#endif
 
 #ifndef ROP_LOAD_STATIC
     BOOL WINAPI DllMain(HINSTANCE hInst, DWORD reason, LPVOID reserved) {
@@ -87,8 +115,15 @@ void ThrowMissingMethod(const char* metName, const char* err);
 #else
 
     #include <dlfcn.h>
+    #include <pthread.h>
     #define ROP_LIB_NAME "librnp-0.so"
     static void *hlib = NULL;
+    static pthread_mutex_t hlock = PTHREAD_MUTEX_INITIALIZER;
+
+    #define ROP_LOCK() pthread_mutex_lock(&hlock)
+    #define ROP_UNLOCK() pthread_mutex_unlock(&hlock)
+    #define ROP_ACQUIRE(ptr) __atomic_load_n(&(ptr), __ATOMIC_ACQUIRE)
+    #define ROP_RELEASE(ptr, val) __atomic_store_n(&(ptr), (val), __ATOMIC_RELEASE)
 
 #ifndef ROP_LOAD_STATIC
     //__attribute__((constructor))
@@ -96,9 +131,15 @@ void ThrowMissingMethod(const char* metName, const char* err);
     static
 #endif
     void on_attach() { 
+        void *lib = NULL;
+        const char *err = NULL;
+        ROP_LOCK();
         if (hlib == NULL)
             hlib = dlopen(ROP_LIB_NAME, RTLD_LAZY); 
-        if(hlib==NULL) ThrowMissingLibrary(ROP_LIB_NAME, dlerror()); 
+        if ((lib = hlib) == NULL)
+            err = dlerror();
+        ROP_UNLOCK();
+        if(lib == NULL) ThrowMissingLibrary(ROP_LIB_NAME, err); 
     }
 
 #ifndef ROP_LOAD_STATIC
@@ -106,43 +147,42 @@ void ThrowMissingMethod(const char* metName, const char* err);
 #else
     static
 #endif
-    void on_detach() { if(hlib != NULL) dlclose(hlib); hlib = NULL; }
+    void on_detach() { 
+        ROP_LOCK();
+        RopUnbindSyms();
+        if(hlib != NULL) dlclose(hlib); 
+        hlib = NULL; 
+        ROP_UNLOCK();
+    }
 
+    static void* RopDlLookup(const char *symbol) {
+        return hlib != NULL? dlsym(hlib, symbol) : NULL;
+    }
+
+#ifndef ROP_LOAD_EAGER
     static void* RopDlSym(const char *symbol) {
         if(hlib != NULL) {
-            void *ptr = dlsym(hlib, symbol);
+            void *ptr = RopDlLookup(symbol);
             if(ptr == NULL)
                 ThrowMissingMethod(symbol, dlerror());
             return ptr;
         }
         return NULL;
     }
+#endif
 
 #endif
 
 #ifdef ROP_LOAD_STATIC
-    void ROP_load() {
-        on_attach();
-    }
-    void ROP_unload() {
-        on_detach();
+    int ROP_has_symbol(const char* symbol) {
+        int found = 0;
+        ROP_LOCK();
+        found = RopDlLookup(symbol) != NULL;
+        ROP_UNLOCK();
+        return found;
     }
 #endif
 
-#define ROP_FFI_DEF_FX(rtype, symb, alist) \
-    static rtype(*p##symb) alist = NULL; \
-    rtype symb
-
-#define ROP_FFI_LOAD_SYMBOL(symb, lsymb) \
-    if(p##symb == NULL) \
-        p##symb = RopDlSym(#lsymb)
-
-#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) \
-    ROP_FFI_DEF_FX(rtype, fname, alist) alist { \
-        ROP_FFI_LOAD_SYMBOL(fname, sname); \
-        return p##fname!=NULL? p##fname plist : rdefl; \
-    }
-
 #define FX
 #define FP0 ()
 #define FA0 ()
@@ -180,7 +220,140 @@ void ThrowMissingMethod(const char* metName, const char* err);
 #define ROP_DYN_IMPORT10(r, d, n, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10) ROP_DYN_IMP10(r, d, dlF(n), n, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10)
 
 
+#ifndef ROP_LOAD_EAGER
+
+#define ROP_FFI_DEF_FX(rtype, symb, alist) \
+    static rtype(*p##symb) alist = NULL; \
+    rtype symb
+
+#define ROP_FFI_LOAD_SYMBOL(symb, lsymb) \
+    if(p##symb == NULL) \
+        p##symb = RopDlSym(#lsymb)
+
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) \
+    ROP_FFI_DEF_FX(rtype, fname, alist) alist { \
+        ROP_FFI_LOAD_SYMBOL(fname, sname); \
+        return p##fname!=NULL? p##fname plist : rdefl; \
+    }
+
+#include "load.h"
+
+#ifdef ROP_LOAD_STATIC
+    void ROP_load() {
+        on_attach();
+    }
+    void ROP_unload() {
+        on_detach();
+    }
+#endif
+
+#else // ROP_LOAD_EAGER
+
+/*
+ * Eager binding: all entry points live in one table which is swapped in as a whole.
+ * Until the library is bound, ropSyms points to bootstrap stubs which bind
+ * everything on first use; symbols missing from the library get stubs throwing
+ * the same error the lazy loader does. A thunk is one indirect call then.
+ * Once unloaded, ropSyms points to stubs failing with a missing library error,
+ * only ROP_load() binds again. A published table is never written to, a load
+ * resolving other addresses publishes a table of its own.
+ */
+
+#include <string.h>
+
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) rtype fname alist;
 #include "load.h"
+#undef ROP_DYN_IMPORT
+
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) rtype (*sname) alist;
+struct RopSymTab {
+#include "load_imports.h"
+};
+#undef ROP_DYN_IMPORT
+
+struct RopSymNode {
+    struct RopSymTab syms;
+    struct RopSymNode *next;
+};
+
+static const struct RopSymTab* RopBindSyms(void);
+
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) \
+    static rtype boot_##sname alist { return RopBindSyms()->sname plist; } \
+    static rtype miss_##sname alist { ThrowMissingMethod(#sname, "not exported by " ROP_LIB_NAME); return (rtype)(rdefl); } \
+    static rtype gone_##sname alist { ThrowMissingLibrary(ROP_LIB_NAME, "library unloaded"); return (rtype)(rdefl); }
+#include "load_imports.h"
+#undef ROP_DYN_IMPORT
+
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) boot_##sname,
+static const struct RopSymTab ropBootSyms = {
+#include "load_imports.h"
+};
+#undef ROP_DYN_IMPORT
+
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) gone_##sname,
+static const struct RopSymTab ropGoneSyms = {
+#include "load_imports.h"
+};
+#undef ROP_DYN_IMPORT
+
+static struct RopSymNode *ropLoadedSyms = NULL;
+static const struct RopSymTab *ropSyms = &ropBootSyms;
+#define ROP_SYMS() ((const struct RopSymTab*)ROP_ACQUIRE(ropSyms))
+
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) \
+    rtype fname alist { return ROP_SYMS()->sname plist; }
+#include "load_imports.h"
+#undef ROP_DYN_IMPORT
+
+static const struct RopSymTab* RopBindSyms(void) {
+    int nomem = 0;
+    on_attach();
+    ROP_LOCK();
+    if (ropSyms == &ropBootSyms || ropSyms == &ropGoneSyms) {
+        struct RopSymTab fresh;
+        struct RopSymNode *node = NULL;
+        void *ptr = NULL;
+        memset(&fresh, 0, sizeof(fresh));
+#define ROP_DYN_IMPORT(rtype, rdefl, fname, sname, alist, plist) \
+        ptr = RopDlLookup(#sname); \
+        fresh.sname = ptr!=NULL? (rtype(*)alist)ptr : miss_##sname;
+#include "load_imports.h"
+#undef ROP_DYN_IMPORT
+        // threads still holding an older table keep reading it unchanged
+        for (node = ropLoadedSyms; node != NULL; node = node->next)
+            if (memcmp(&node->syms, &fresh, sizeof(fresh)) == 0)
+                break;
+        if (node == NULL && (node = (struct RopSymNode*)malloc(sizeof(*node))) != NULL) {
+            node->syms = fresh;
+            node->next = ropLoadedSyms;
+            ropLoadedSyms = node;
+        }
+        if (node != NULL)
+            ROP_RELEASE(ropSyms, &node->syms);
+        else
+            nomem = 1;
+    }
+    ROP_UNLOCK();
+    if (nomem)
+        ThrowMissingLibrary(ROP_LIB_NAME, "out of memory");
+    return ROP_SYMS();
+}
+
+static void RopUnbindSyms(void) {
+    ROP_RELEASE(ropSyms, &ropGoneSyms);
+}
+
+#ifdef ROP_LOAD_STATIC
+    void ROP_load() {
+        RopBindSyms();
+    }
+    void ROP_unload() {
+        on_detach();
+    }
+#endif
+
+#endif // ROP_LOAD_EAGER
 
 
 #ifdef __cplusplus
@@ -34,6 +34,7 @@
 #include "cerop/util.hpp"
 #include "cerop/key.hpp"
 #include "cerop/op.hpp"
+#include "cerop/session.hpp"
 
 
 CEROP_NAMESPACE_BEGIN {
@@ -101,6 +102,10 @@ void RopOpSignT::set_file_mtime(const Instant& mtime) { API_PROLOG
 void RopOpSignT::execute() { API_PROLOG
     Util::CheckError(CALL(rnp_op_sign_execute)(HCAST_OPSIG(handle)));
 }
+std::future<void> RopOpSignT::execute_async(RopWorkerPool& pool, const bool wait) { API_PROLOG
+    RopObject self = me.lock();
+    return RopSessionT::Serialized(RopSessionT::SessionOf(this), pool, [self, this]() { execute(); }, wait);
+}
 RopSignSignature RopOpSignT::add_signature(const RopKey& key) { API_PROLOG
     rnp_op_sign_signature_t sig = nullptr;
     RET_ROP_OBJECT(RopSignSignature, sig, CALL(rnp_op_sign_add_signature)(HCAST_OPSIG(handle), HCAST_KEY(RopObjectT::getHandle(key)), &sig));
@@ -272,6 +277,10 @@ void RopOpEncryptT::set_file_mtime(const Instant& mtime) { API_PROLOG
 void RopOpEncryptT::execute() { API_PROLOG
     Util::CheckError(CALL(rnp_op_encrypt_execute)(HCAST_OPENC(handle)));
 }
+std::future<void> RopOpEncryptT::execute_async(RopWorkerPool& pool, const bool wait) { API_PROLOG
+    RopObject self = me.lock();
+    return RopSessionT::Serialized(RopSessionT::SessionOf(this), pool, [self, this]() { execute(); }, wait);
+}
 
 
 RopVeriSignatureT::RopVeriSignatureT(const RopObjRef& parent, const RopHandle vid) : RopObjectT(parent.lock(), vid) {
@@ -286,7 +295,7 @@ RopVeriSignatureT::~RopVeriSignatureT() {
 
 RopString RopVeriSignatureT::hash() { API_PROLOG
     char *hash = nullptr;
-    return Util::GetRopString(me, CALL(rnp_op_verify_signature_get_hash)(HCAST_OPVES(handle), &hash), &hash);
+    return Util::GetRopString(*this, CALL(rnp_op_verify_signature_get_hash)(HCAST_OPVES(handle), &hash), &hash);
 }
 unsigned RopVeriSignatureT::status() { API_PROLOG
     return CALL(rnp_op_verify_signature_get_status)(HCAST_OPVES(handle));
@@ -321,11 +330,11 @@ RopRecipientT::~RopRecipientT() {
 
 RopString RopRecipientT::get_keyid() { API_PROLOG
     char *keyid = nullptr;
-    return Util::GetRopString(me, CALL(rnp_recipient_get_keyid)(HCAST_RECIP(handle), &keyid), &keyid);
+    return Util::GetRopString(*this, CALL(rnp_recipient_get_keyid)(HCAST_RECIP(handle), &keyid), &keyid);
 }
 RopString RopRecipientT::get_alg() { API_PROLOG
     char *alg = nullptr;
-    return Util::GetRopString(me, CALL(rnp_recipient_get_alg)(HCAST_RECIP(handle), &alg), &alg);
+    return Util::GetRopString(*this, CALL(rnp_recipient_get_alg)(HCAST_RECIP(handle), &alg), &alg);
 }
 
 
@@ -341,19 +350,19 @@ RopSymEncT::~RopSymEncT() {
 
 RopString RopSymEncT::get_cipher() { API_PROLOG
     char *cipher = nullptr;
-    return Util::GetRopString(me, CALL(rnp_symenc_get_cipher)(HCAST_SENC(handle), &cipher), &cipher);
+    return Util::GetRopString(*this, CALL(rnp_symenc_get_cipher)(HCAST_SENC(handle), &cipher), &cipher);
 }
 RopString RopSymEncT::get_aead_alg() { API_PROLOG
     char *alg = nullptr;
-    return Util::GetRopString(me, CALL(rnp_symenc_get_aead_alg)(HCAST_SENC(handle), &alg), &alg);
+    return Util::GetRopString(*this, CALL(rnp_symenc_get_aead_alg)(HCAST_SENC(handle), &alg), &alg);
 }
 RopString RopSymEncT::get_hash_alg() { API_PROLOG
     char *alg = nullptr;
-    return Util::GetRopString(me, CALL(rnp_symenc_get_hash_alg)(HCAST_SENC(handle), &alg), &alg);
+    return Util::GetRopString(*this, CALL(rnp_symenc_get_hash_alg)(HCAST_SENC(handle), &alg), &alg);
 }
 RopString RopSymEncT::get_s2k_type() { API_PROLOG
     char *type = nullptr;
-    return Util::GetRopString(me, CALL(rnp_symenc_get_s2k_type)(HCAST_SENC(handle), &type), &type);
+    return Util::GetRopString(*this, CALL(rnp_symenc_get_s2k_type)(HCAST_SENC(handle), &type), &type);
 }
 uint32_t RopSymEncT::get_s2k_iterations() { API_PROLOG
     uint32_t iterations = false;
@@ -383,6 +392,14 @@ size_t RopOpVerifyT::signature_count() { API_PROLOG
 void RopOpVerifyT::execute() { API_PROLOG
     Util::CheckError(CALL(rnp_op_verify_execute)(HCAST_OPVER(handle)));
 }
+RopResult<void> RopOpVerifyT::try_execute() noexcept { TRY_PROLOG
+    return CALL(rnp_op_verify_execute)(HCAST_OPVER(handle));
+    TRY_EPILOG
+}
+std::future<void> RopOpVerifyT::execute_async(RopWorkerPool& pool, const bool wait) { API_PROLOG
+    RopObject self = me.lock();
+    return RopSessionT::Serialized(RopSessionT::SessionOf(this), pool, [self, this]() { execute(); }, wait);
+}
 RopVeriSignature RopOpVerifyT::get_signature_at(size_t idx) { API_PROLOG
     rnp_op_verify_signature_t sig = nullptr;
     RET_ROP_OBJECT(RopVeriSignature, sig, CALL(rnp_op_verify_get_signature_at)(HCAST_OPVER(handle), idx, &sig));
@@ -390,15 +407,15 @@ RopVeriSignature RopOpVerifyT::get_signature_at(size_t idx) { API_PROLOG
 RopOpVerifyT::FileInfoP RopOpVerifyT::get_file_info() { API_PROLOG
     char *filename = nullptr;
     uint32_t mtime = 0;
-    RopString fname = Util::GetRopString(me, CALL(rnp_op_verify_get_file_info)(HCAST_OPVER(handle), &filename, &mtime), &filename);
+    RopString fname = Util::GetRopString(*this, CALL(rnp_op_verify_get_file_info)(HCAST_OPVER(handle), &filename, &mtime), &filename);
     return RopOpVerifyT::FileInfoP(new RopOpVerifyT::FileInfo((const char*)*fname, Instant(Duration(mtime))));
 }
 bool RopOpVerifyT::get_protection_info(RopString* mode, RopString* cipher) { API_PROLOG
     char *mod = nullptr, *cip = nullptr;
     char **pmod = (mode? &mod : nullptr), **pcip = (cipher? &cip : nullptr);
     bool valid = false;
-    RopString modS = Util::GetRopString(me, CALL(rnp_op_verify_get_protection_info)(HCAST_OPVER(handle), pmod, pcip, &valid), pmod);
-    RopString cipS = Util::GetRopString(me, ROPE::SUCCESS, pcip);
+    RopString modS = Util::GetRopString(*this, CALL(rnp_op_verify_get_protection_info)(HCAST_OPVER(handle), pmod, pcip, &valid), pmod);
+    RopString cipS = Util::GetRopString(*this, ROPE::SUCCESS, pcip);
     if(mode) *mode = modS;
     if(cipher) *cipher = cipS;
     return valid;
@@ -31,6 +31,9 @@
 
 #include <cstring>
 #include <algorithm>
+#include <list>
+#include <deque>
+#include <unordered_map>
 #include "load.h"
 #include "cerop/util.hpp"
 #include "cerop/error.hpp"
@@ -40,13 +43,59 @@
 
 CEROP_NAMESPACE_BEGIN {
 
+/**
+ * Cached key handles have no parent, so that the cache does not keep its
+ * session alive; lookups get views of them, which borrow the handle and
+ * keep both the session and the cached key alive.
+ */
+struct RopSessionT::KeyCache {
+    class KeyViewT : public RopKeyT {
+    public:
+        inline KeyViewT(const RopObjRef& parent, const RopHandle kid) : RopKeyT(parent, kid) {}
+        inline ~KeyViewT() { Detach(); }
+    };
+    typedef std::list<std::pair<StringT, RopKey>> Order;
+    inline KeyCache(const size_t capacity) : capacity(capacity) {}
+    const size_t capacity;
+    Order order;
+    std::unordered_map<StringT, Order::iterator> index;
+};
+
+/**
+ * Async calls of a session waiting for the one running, each with the
+ * pool it was made on
+ */
+struct RopSessionT::AsyncChain {
+    typedef std::pair<RopWorkerPool*, std::function<void()>> Job;
+    std::mutex lock;
+    std::deque<Job> pending;
+    bool running = false;
+};
+
+static inline StringT KeyCacheId(const char* identifier_type, const char* identifier) {
+    StringT id(identifier_type!=nullptr? identifier_type : "");
+    id.push_back('\0');
+    id.append(identifier!=nullptr? identifier : "");
+    return id;
+}
+
 RopSessionT::RopSessionT(const RopObjRef& parent, const RopHandle sid) : RopObjectT(parent.lock()) {
     Attach(sid);
+    errq = &errors;
+    pool = new RopPoolT();
+    keyCache = nullptr;
+    asyncChain = std::make_shared<AsyncChain>();
+    keyEdits = 0;
+    digestsValid = false;
     passProvider = nullptr;
     keyProvider = nullptr;
 }
 
 RopSessionT::~RopSessionT() {
+    // the own queue goes away with the session, failures here are reported to the bind
+    errq = QueueOf(parent.get());
+    delete keyCache;
+    keyCache = nullptr;
     if(handle != nullptr) {
         try {
             Util::CheckError(CALL(rnp_ffi_destroy)(HCAST_FFI(handle)));
@@ -55,6 +104,10 @@ RopSessionT::~RopSessionT() {
         }
         handle = nullptr;
     }
+    if(pool != nullptr) {
+        pool->Release();
+        pool = nullptr;
+    }
 }
 
 RopBind RopSessionT::getBind() {
@@ -85,6 +138,7 @@ RopOpSign RopSessionT::op_sign_create(const RopInput& input, const RopOutput& ou
 }
 
 RopOpGenerate RopSessionT::op_generate_create_subkey(const InString& keyAlg, const RopKey& primary) { API_PROLOG
+    keyEdits++;
     unsigned ret = ROPE::SUCCESS;
     rnp_op_generate_t op = nullptr;
     if(!primary)
@@ -127,6 +181,7 @@ String RopSessionT::request_password(const RopKey& key, const char* context) { A
 }
 
 void RopSessionT::load_keys(const InString& format, const RopInput& input, const bool pub, const bool sec) { API_PROLOG
+    InvalidateKeys();
     RopHandle inp = RopObjectT::getHandle(input);
     unsigned flags = (pub? RNP_LOAD_SAVE_PUBLIC_KEYS : 0);
     flags |= (sec? RNP_LOAD_SAVE_SECRET_KEYS : 0);
@@ -134,36 +189,155 @@ void RopSessionT::load_keys(const InString& format, const RopInput& input, const
 }
 
 void RopSessionT::unload_keys(const bool pub, const bool sec) { API_PROLOG
+    InvalidateKeys();
     unsigned flags = (pub? RNP_KEY_UNLOAD_PUBLIC : 0);
     flags |= (sec? RNP_KEY_UNLOAD_SECRET : 0);
     Util::CheckError(CALL(rnp_unload_keys)(HCAST_FFI(handle), flags));
 }
 
 RopKey RopSessionT::locate_key(const InString& identifier_type, const InString& identifier) { API_PROLOG
+    if(keyCache != nullptr) {
+        RopKey cached = CachedKey(identifier_type, identifier);
+        if(!cached) {
+            rnp_key_handle_t key = nullptr;
+            Util::CheckError(CALL(rnp_locate_key)(HCAST_FFI(handle), identifier_type, identifier, &key));
+            cached = CacheKey(identifier_type, identifier, key);
+        }
+        return KeyView(cached);
+    }
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_locate_key)(HCAST_FFI(handle), identifier_type, identifier, &key));
 }
+void RopSessionT::set_key_cache(const size_t capacity) { API_PROLOG
+    delete keyCache;
+    keyCache = nullptr;
+    if(capacity > 0)
+        keyCache = new KeyCache(capacity);
+}
+RopKey RopSessionT::KeyView(const RopKey& cached) {
+    RopKey obj = Make<KeyCache::KeyViewT>(pool, me, RopObjectT::getHandle(cached));
+    obj->FeedBack(obj, cached);
+    return obj;
+}
+RopKey RopSessionT::CachedKey(const char* identifier_type, const char* identifier) {
+    KeyCache::Order::iterator hit;
+    {
+        auto found = keyCache->index.find(KeyCacheId(identifier_type, identifier));
+        if(found == keyCache->index.end())
+            return RopKey();
+        hit = found->second;
+    }
+    keyCache->order.splice(keyCache->order.begin(), keyCache->order, hit);
+    return hit->second;
+}
+RopKey RopSessionT::CacheKey(const char* identifier_type, const char* identifier, const RopHandle handle) {
+    RopKey key = Make<RopKeyT>(nullptr, RopObjRef(), handle);
+    key->FeedBack(key);
+    StringT id = KeyCacheId(identifier_type, identifier);
+    keyCache->order.push_front(std::make_pair(id, key));
+    try {
+        keyCache->index[id] = keyCache->order.begin();
+    } catch(...) {
+        keyCache->order.pop_front();
+        throw;
+    }
+    if(keyCache->order.size() > keyCache->capacity) {
+        keyCache->index.erase(keyCache->order.back().first);
+        keyCache->order.pop_back();
+    }
+    return key;
+}
+void RopSessionT::InvalidateKeys() noexcept {
+    keyEdits++;
+    digestsValid = false;
+    if(keyCache != nullptr) {
+        keyCache->index.clear();
+        keyCache->order.clear();
+    }
+}
+RopResult<RopKey> RopSessionT::try_locate_key(const InString& identifier_type, const InString& identifier) noexcept { TRY_PROLOG
+    if(keyCache != nullptr) {
+        RopKey cached = CachedKey(identifier_type, identifier);
+        if(cached)
+            return KeyView(cached);
+    }
+    rnp_key_handle_t key = nullptr;
+    unsigned ret = CALL(rnp_locate_key)(HCAST_FFI(handle), identifier_type, identifier, &key);
+    if(ret != ROPE::SUCCESS)
+        return RopFailure(ret);
+    if(key == nullptr)
+        return RopFailure(ROPE::ERROR_KEY_NOT_FOUND);
+    if(keyCache != nullptr)
+        return KeyView(CacheKey(identifier_type, identifier, key));
+    RopKey obj = Make<RopKeyT>(pool, me, key);
+    obj->FeedBack(obj);
+    return obj;
+    TRY_EPILOG
+}
+std::vector<RopKey> RopSessionT::locate_keys(const InString& identifier_type, const StringsT& ids) { API_PROLOG
+    std::vector<RopKey> keys;
+    keys.reserve(ids.size());
+    for(const StringT& id : ids) {
+        RopResult<RopKey> key = try_locate_key(identifier_type, id);
+        if(key.getErrCode() == ROPE::ERROR_OUT_OF_MEMORY)
+            throw std::bad_alloc();
+        if(!key && key.getErrCode() != ROPE::ERROR_KEY_NOT_FOUND)
+            throw RopError(key.getErrCode());
+        keys.push_back(key? *key : RopKey());
+    }
+    return keys;
+}
+std::vector<RopKeySnapshotT> RopSessionT::key_snapshots() { API_PROLOG
+    std::vector<RopKeySnapshotT> snaps;
+    const bool validity = getBind()->has(RopBindT::Capability::KEY_VALIDITY);
+    RopIdIterator it = identifier_iterator_create("fingerprint");
+    for(;;) {
+        const char *fprint = nullptr;
+        Util::CheckError(CALL(rnp_identifier_iterator_next)(HCAST_IDIT(RopObjectT::getHandle(it)), &fprint));
+        if(fprint == nullptr)
+            break;
+        rnp_key_handle_t key = nullptr;
+        Util::CheckError(CALL(rnp_locate_key)(HCAST_FFI(handle), "fingerprint", fprint, &key));
+        if(key == nullptr)
+            continue;
+        try {
+            snaps.push_back(RopKeySnapshotT());
+            RopKeyT::Snapshot(key, snaps.back(), validity);
+        } catch(...) {
+            CALL(rnp_key_handle_destroy)(key);
+            throw;
+        }
+        CALL(rnp_key_handle_destroy)(key);
+    }
+    return snaps;
+}
 RopKey RopSessionT::generate_key_rsa(const uint32_t bits, const uint32_t subbits, const InString& userid, const InString& password) { API_PROLOG
+    keyEdits++;
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_generate_key_rsa)(HCAST_FFI(handle), bits, subbits, userid, password, &key));
 }
 RopKey RopSessionT::generate_key_dsa_eg(const uint32_t bits, const uint32_t subbits, const InString& userid, const InString& password) { API_PROLOG
+    keyEdits++;
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_generate_key_dsa_eg)(HCAST_FFI(handle), bits, subbits, userid, password, &key));
 }
 RopKey RopSessionT::generate_key_ec(const InString& curve, const InString& userid, const InString& password) { API_PROLOG
+    keyEdits++;
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_generate_key_ec)(HCAST_FFI(handle), curve, userid, password, &key));
 }
 RopKey RopSessionT::generate_key_25519(const InString& userid, const InString& password) { API_PROLOG
+    keyEdits++;
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_generate_key_25519)(HCAST_FFI(handle), userid, password, &key));
 }
 RopKey RopSessionT::generate_key_sm2(const InString& userid, const InString& password) { API_PROLOG
+    keyEdits++;
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_generate_key_sm2)(HCAST_FFI(handle), userid, password, &key));
 }
 RopKey RopSessionT::generate_key_ex(const InString& keyAlg, const InString& subAlg, const uint32_t keyBits, const uint32_t subBits, const InString& keyCurve, const InString& subCurve, const InString& userid, const InString& password) { API_PROLOG
+    keyEdits++;
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_generate_key_ex)(HCAST_FFI(handle), keyAlg, subAlg, keyBits, subBits, keyCurve, subCurve, userid, password, &key));
 }
@@ -174,10 +348,109 @@ RopData RopSessionT::import_keys(const RopInput& input, const bool pub, const bo
     flags |= (sec? RNP_LOAD_SAVE_SECRET_KEYS : 0);
     flags |= (perm? RNP_LOAD_SAVE_PERMISSIVE : 0);
     flags |= (sngl? RNP_LOAD_SAVE_SINGLE : 0);
+    InvalidateKeys();
     unsigned ret = CALL(rnp_import_keys)(HCAST_FFI(handle), HCAST_INP(inp), flags, &results);
-    RopData rd = Util::GetRopData(me, ret!=ROPE::ERROR_EOF? ret : ROPE::SUCCESS, results, Util::StrLen(results));
+    RopData rd = Util::GetRopData(*this, ret!=ROPE::ERROR_EOF? ret : ROPE::SUCCESS, results, Util::StrLen(results));
     return ret!=ROPE::ERROR_EOF? rd : RopData(nullptr);
 }
+/**
+ * String value of a field in the flat JSON object [obj, end),
+ * nullptr if it is missing.
+ */
+static const char* JsonField(const char* obj, const char* end, const char* name, size_t& len) {
+    const size_t nlen = std::strlen(name);
+    for(const char *pos = obj; pos + nlen + 2 <= end; pos++) {
+        if(pos[0] != '"' || std::strncmp(pos+1, name, nlen) != 0 || pos[nlen+1] != '"')
+            continue;
+        const char *val = pos + nlen + 2;
+        while(val < end && (*val == ' ' || *val == ':' || *val == '\n' || *val == '\t'))
+            val++;
+        if(val >= end || *val != '"')
+            return nullptr;
+        const char *close = static_cast<const char*>(std::memchr(val+1, '"', end - val - 1));
+        if(close == nullptr)
+            return nullptr;
+        len = close - val - 1;
+        return val + 1;
+    }
+    return nullptr;
+}
+static SessionImportCallBack::Status ImportStatus(const char* obj, const char* end, const char* name) {
+    static const char *const names[] = { "none", "unchanged", "updated", "new" };
+    size_t len = 0;
+    const char *val = JsonField(obj, end, name, len);
+    for(unsigned idx = 0; val != nullptr && idx < sizeof(names)/sizeof(names[0]); idx++)
+        if(std::strlen(names[idx]) == len && std::strncmp(val, names[idx], len) == 0)
+            return static_cast<SessionImportCallBack::Status>(idx);
+    return SessionImportCallBack::UNKNOWN;
+}
+size_t RopSessionT::import_keys_stream(const RopInput& input, SessionImportCallBack* importcb, void* importcbCtx, const bool pub, const bool sec, const bool perm) { API_PROLOG
+    RopHandle inp = RopObjectT::getHandle(input);
+    unsigned flags = (pub? RNP_LOAD_SAVE_PUBLIC_KEYS : 0);
+    flags |= (sec? RNP_LOAD_SAVE_SECRET_KEYS : 0);
+    flags |= (perm? RNP_LOAD_SAVE_PERMISSIVE : 0);
+    flags |= RNP_LOAD_SAVE_SINGLE;
+    InvalidateKeys();
+    RopSession self = std::static_pointer_cast<RopSessionT>(me.lock());
+    size_t count = 0;
+    for(bool more = true; more; ) {
+        char *results = nullptr;
+        const unsigned ret = CALL(rnp_import_keys)(HCAST_FFI(handle), HCAST_INP(inp), flags, &results);
+        if(ret == ROPE::ERROR_EOF)
+            break;
+        Util::CheckError(ret);
+        if(results == nullptr)
+            break;
+        try {
+            // one object per imported key or subkey in the "keys" array
+            const char *pos = std::strstr(results, "\"keys\"");
+            pos = pos!=nullptr? std::strchr(pos, '[') : nullptr;
+            // the whole batch is imported already, so it is reported even once the callback stops
+            while(pos != nullptr) {
+                pos += std::strspn(pos + 1, " \t\r\n,") + 1;
+                // a ']' ends the array
+                if(*pos != '{')
+                    break;
+                const char *close = std::strchr(pos, '}');
+                if(close == nullptr)
+                    break;
+                SessionImportCallBack::Key key;
+                size_t len = 0;
+                const char *fprint = JsonField(pos, close, "fingerprint", len);
+                len = fprint!=nullptr? std::min(len, sizeof(key.fprint)-1) : 0;
+                if(len > 0)
+                    std::memcpy(key.fprint, fprint, len);
+                key.fprint[len] = '\0';
+                key.pub = ImportStatus(pos, close, "public");
+                key.sec = ImportStatus(pos, close, "secret");
+                count++;
+                if(importcb != nullptr && !importcb->ImportCallBack(self, importcbCtx, key))
+                    more = false;
+                pos = close;
+            }
+        } catch(...) {
+            CALL(rnp_buffer_destroy)(results);
+            throw;
+        }
+        CALL(rnp_buffer_destroy)(results);
+    }
+    return count;
+}
+RopResult<RopData> RopSessionT::try_import_keys(const RopInput& input, const bool pub, const bool sec, const bool perm, bool sngl) noexcept { TRY_PROLOG
+    char *results = nullptr;
+    RopHandle inp = RopObjectT::getHandle(input);
+    unsigned flags = (pub? RNP_LOAD_SAVE_PUBLIC_KEYS : 0);
+    flags |= (sec? RNP_LOAD_SAVE_SECRET_KEYS : 0);
+    flags |= (perm? RNP_LOAD_SAVE_PERMISSIVE : 0);
+    flags |= (sngl? RNP_LOAD_SAVE_SINGLE : 0);
+    InvalidateKeys();
+    unsigned ret = CALL(rnp_import_keys)(HCAST_FFI(handle), HCAST_INP(inp), flags, &results);
+    RopData rd = Util::GetRopData(*this, ROPE::SUCCESS, results, Util::StrLen(results));
+    if(ret != ROPE::SUCCESS)
+        return RopFailure(ret);
+    return rd;
+    TRY_EPILOG
+}
 
 bool password_cb(void* ffi_, void* app_ctx, void* key_, const char* pgp_context, char buf[], size_t buf_len) {
     RopSessionT *ses = static_cast<RopSessionT*>(app_ctx);
@@ -187,8 +460,8 @@ bool password_cb(void* ffi_, void* app_ctx, void* key_, const char* pgp_context,
     if(ses != nullptr && ses->passProvider != nullptr) {
         // create new Session and Key handlers
         try {
-            RopSession ropSes(ffi!=nullptr? new RopSessionT(ses->parent, ffi) : nullptr);
-            RopKey ropKey(key!=nullptr? new RopKeyT(ses->parent, key) : nullptr);
+            RopSession ropSes(ffi!=nullptr? RopSessionT::Make<RopSessionT>(nullptr, ses->parent, ffi) : nullptr);
+            RopKey ropKey(key!=nullptr? RopSessionT::Make<RopKeyT>(nullptr, ses->parent, key) : nullptr);
             SessionPassCallBack::Ret scbRet = ses->passProvider->PassCallBack(ropSes, ses->passcbCtx, ropKey, pgp_context, buf_len);
             if(ropSes)
                 ropSes->Detach();
@@ -205,6 +478,7 @@ bool password_cb(void* ffi_, void* app_ctx, void* key_, const char* pgp_context,
     return false;
 }
 void RopSessionT::set_pass_provider(SessionPassCallBack* getpasscb, void* getpasscbCtx) { API_PROLOG
+    keyEdits++;
     this->passProvider = getpasscb;
     this->passcbCtx = getpasscbCtx;
     Util::CheckError(CALL(rnp_ffi_set_pass_provider)(HCAST_FFI(handle), reinterpret_cast<rnp_password_cb>(password_cb), getpasscb!=nullptr? this : nullptr));
@@ -223,24 +497,29 @@ void key_cb(void* ffi_, void* app_ctx, const char* identifier_type, const char*
     rnp_ffi_t ffi = static_cast<rnp_ffi_t>(ffi_);
 
     if(ses != nullptr && ses->keyProvider != nullptr) {
-        // create a new Session handler
         try {
-            RopSession ropSes(ffi!=nullptr? new RopSessionT(ses->parent, ffi) : nullptr);
+            // the provider is registered on this session, hand it over instead of a new handler
+            RopSession ropSes = ffi == ses->handle? std::static_pointer_cast<RopSessionT>(ses->me.lock()) : nullptr;
+            const bool own = !ropSes && ffi != nullptr;
+            if(own)
+                ropSes = RopSessionT::Make<RopSessionT>(nullptr, ses->parent, ffi);
             ses->keyProvider->KeyCallBack(ropSes, ses->keycbCtx, identifier_type, identifier, secret);
-            if(ropSes)
+            if(own)
                 ropSes->Detach();
         } catch(RopError ex) {}
     }
 }
 void RopSessionT::set_key_provider(SessionKeyCallBack* keyProvider, void* getkeycbCtx) { API_PROLOG
+    keyEdits++;
     this->keyProvider = keyProvider;
     this->keycbCtx = getkeycbCtx;
     Util::CheckError(CALL(rnp_ffi_set_key_provider)(HCAST_FFI(handle), reinterpret_cast<rnp_get_key_cb>(key_cb), keyProvider!=nullptr? this : nullptr));
 }
 RopString RopSessionT::import_signatures(const RopInput& input) { API_PROLOG
+    keyEdits++;
     char *results = nullptr;
     RopHandle inp = RopObjectT::getHandle(input);
-    return Util::GetRopString(me, CALL(rnp_import_signatures)(HCAST_FFI(handle), HCAST_INP(inp), 0, &results), &results);
+    return Util::GetRopString(*this, CALL(rnp_import_signatures)(HCAST_FFI(handle), HCAST_INP(inp), 0, &results), &results);
 }
 void RopSessionT::save_keys(const InString& format, const RopOutput& output, const bool pub, const bool sec) { API_PROLOG
     RopHandle outp = RopObjectT::getHandle(output);
@@ -249,15 +528,252 @@ void RopSessionT::save_keys(const InString& format, const RopOutput& output, con
     Util::CheckError(CALL(rnp_save_keys)(HCAST_FFI(handle), format, HCAST_OUTP(outp), flags));
 }
 RopData RopSessionT::generate_key_json(const RopDataT& json) { API_PROLOG
+    keyEdits++;
     char *results = nullptr;
     unsigned ret = CALL(rnp_generate_key_json)(HCAST_FFI(handle), (const char*)(json), &results);
-    return Util::GetRopData(me, ret, results, Util::StrLen(results));
+    return Util::GetRopData(*this, ret, results, Util::StrLen(results));
+}
+void RopSessionT::reload_keys(const InString& format, const RopInput& input) { API_PROLOG
+    RopBind bind = getBind();
+    RopSession fresh = bind->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    fresh->load_keys(format, input);
+    std::unordered_map<StringT, uint64_t> incoming;
+    fresh->DigestKeys(incoming);
+    if(!digestsValid) {
+        keyDigests.clear();
+        DigestKeys(keyDigests);
+    }
+
+    StringsT gone, changed;
+    for(const std::pair<const StringT, uint64_t>& key : keyDigests)
+        if(incoming.find(key.first) == incoming.end())
+            gone.push_back(key.first);
+    for(const std::pair<const StringT, uint64_t>& key : incoming) {
+        auto known = keyDigests.find(key.first);
+        if(known == keyDigests.end() || known->second != key.second)
+            changed.push_back(key.first);
+    }
+    if(!gone.empty())
+        RemoveKeys(gone);
+    for(const StringT& fprint : gone)
+        keyDigests.erase(fprint);
+    if(!changed.empty()) {
+        std::vector<uint8_t> update = fresh->ExportKeys(changed);
+        // merging what the session holds into the fresh keys tells, within one
+        // session, which keys would keep packets the input dropped
+        std::vector<uint8_t> held = ExportKeys(changed);
+        if(!held.empty()) {
+            fresh->import_keys(bind->create_input(RopDataT(held.data(), held.size()), false));
+            std::unordered_map<StringT, uint64_t> merged;
+            fresh->DigestKeys(merged, &changed);
+            StringsT stale;
+            for(const StringT& fprint : changed)
+                if(merged[fprint] != incoming[fprint])
+                    stale.push_back(fprint);
+            if(!stale.empty())
+                RemoveKeys(stale);
+        }
+        // the other changed keys are merged, which keeps their handles valid
+        import_keys(bind->create_input(RopDataT(update.data(), update.size()), false));
+        for(const StringT& fprint : changed)
+            keyDigests[fprint] = incoming[fprint];
+    }
+    digestsValid = true;
+}
+static void ExportKey(const RopHandle key, const RopHandle output) {
+    // rnp exports public and secret packets only in separate calls
+    Util::CheckError(CALL(rnp_key_export)(HCAST_KEY(key), HCAST_OUTP(output), RNP_KEY_EXPORT_PUBLIC | RNP_KEY_EXPORT_SUBKEYS));
+    bool secret = false;
+    Util::CheckError(CALL(rnp_key_have_secret)(HCAST_KEY(key), &secret));
+    if(secret)
+        Util::CheckError(CALL(rnp_key_export)(HCAST_KEY(key), HCAST_OUTP(output), RNP_KEY_EXPORT_SECRET | RNP_KEY_EXPORT_SUBKEYS));
+}
+template<typename F>
+void RopSessionT::WithKey(const char* fprint, F fn) {
+    rnp_key_handle_t key = nullptr;
+    Util::CheckError(CALL(rnp_locate_key)(HCAST_FFI(handle), "fingerprint", fprint, &key));
+    if(key == nullptr)
+        return;
+    try {
+        fn(key);
+    } catch(...) {
+        CALL(rnp_key_handle_destroy)(key);
+        throw;
+    }
+    CALL(rnp_key_handle_destroy)(key);
+}
+void RopSessionT::DigestKeys(std::unordered_map<StringT, uint64_t>& digests, const StringsT* fprints) {
+    // raw handles, a RopKey per key would flush and refill the key cache
+    RopBind bind = getBind();
+    std::vector<uint8_t> packets;
+    auto digest = [&](const char* fprint) {
+        WithKey(fprint, [&](const RopHandle key) {
+            bool primary = false;
+            Util::CheckError(CALL(rnp_key_is_primary)(HCAST_KEY(key), &primary));
+            if(!primary)
+                return;
+            packets.clear();
+            {
+                RopOutput output = bind->create_output_memory(packets);
+                ExportKey(key, RopObjectT::getHandle(output));
+            }
+            // FNV-1a over the exported packets
+            uint64_t hash = 14695981039346656037ULL;
+            for(const uint8_t val : packets)
+                hash = (hash ^ val) * 1099511628211ULL;
+            digests[StringT(fprint)] = hash;
+        });
+    };
+    if(fprints != nullptr) {
+        for(const StringT& fprint : *fprints)
+            digest(fprint.c_str());
+        return;
+    }
+    RopIdIterator it = identifier_iterator_create("fingerprint");
+    for(;;) {
+        const char *fprint = nullptr;
+        Util::CheckError(CALL(rnp_identifier_iterator_next)(HCAST_IDIT(RopObjectT::getHandle(it)), &fprint));
+        if(fprint == nullptr)
+            break;
+        digest(fprint);
+    }
+}
+std::vector<uint8_t> RopSessionT::ExportKeys(const StringsT& fprints) {
+    std::vector<uint8_t> packets;
+    {
+        RopOutput output = getBind()->create_output_memory(packets);
+        for(const StringT& fprint : fprints)
+            WithKey(fprint.c_str(), [&](const RopHandle key) {
+                ExportKey(key, RopObjectT::getHandle(output));
+            });
+    }
+    return packets;
+}
+void RopSessionT::RemoveKeys(const StringsT& fprints) {
+    InvalidateKeys();
+    for(const StringT& fprint : fprints)
+        WithKey(fprint.c_str(), [&](const RopHandle key) {
+            bool secret = false;
+            Util::CheckError(CALL(rnp_key_have_secret)(HCAST_KEY(key), &secret));
+            unsigned flags = RNP_KEY_REMOVE_PUBLIC | RNP_KEY_REMOVE_SUBKEYS;
+            flags |= (secret? RNP_KEY_REMOVE_SECRET : 0);
+            Util::CheckError(CALL(rnp_key_remove)(HCAST_KEY(key), flags));
+        });
+}
+RopSnapshot RopSessionT::snapshot() { API_PROLOG
+    std::shared_ptr<RopSnapshotT> snap = std::make_shared<RopSnapshotT>();
+    RopBind bind = getBind();
+    {
+        RopOutput pub = bind->create_output_memory(snap->pub);
+        save_keys_public(RopBindT::KEYSTORE_GPG, pub);
+    }
+    {
+        RopOutput sec = bind->create_output_memory(snap->sec);
+        save_keys_secret(RopBindT::KEYSTORE_GPG, sec);
+    }
+    return snap;
+}
+void RopSessionT::restore(const RopSnapshot& snap) { API_PROLOG
+    RopBind bind = getBind();
+    unload_keys();
+    if(snap && !snap->pub.empty())
+        load_keys_public(RopBindT::KEYSTORE_GPG, bind->create_input(RopDataT(snap->pub.data(), snap->pub.size()), false));
+    if(snap && !snap->sec.empty())
+        load_keys_secret(RopBindT::KEYSTORE_GPG, bind->create_input(RopDataT(snap->sec.data(), snap->sec.size()), false));
+}
+RopSession RopSessionT::clone() { API_PROLOG
+    RopSession ses = getBind()->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    ses->restore(snapshot());
+    return ses;
 }
 void RopSessionT::decrypt(const RopInput& input, const RopOutput& output) { API_PROLOG
     RopHandle inp = RopObjectT::getHandle(input);
     RopHandle outp = RopObjectT::getHandle(output);
     Util::CheckError(CALL(rnp_decrypt)(HCAST_FFI(handle), HCAST_INP(inp), HCAST_OUTP(outp)));
 }
+std::future<void> RopSessionT::decrypt_async(RopWorkerPool& pool, const RopInput& input, const RopOutput& output, const bool wait) { API_PROLOG
+    RopObject self = me.lock();
+    return Serialized(this, pool, [self, this, input, output]() { decrypt(input, output); }, wait);
+}
+RopSessionT* RopSessionT::SessionOf(RopObjectT* obj) noexcept {
+    for(; obj != nullptr; obj = ParentOf(obj)) {
+        RopSessionT *ses = dynamic_cast<RopSessionT*>(obj);
+        if(ses != nullptr)
+            return ses;
+    }
+    return nullptr;
+}
+std::future<void> RopSessionT::Serialized(RopSessionT* ses, RopWorkerPool& pool, const std::function<void()>& fx, const bool wait) {
+    std::shared_ptr<std::promise<void>> done = std::make_shared<std::promise<void>>();
+    std::future<void> result = done->get_future();
+    // the captures go before the future is ready, so outputs are flushed by then
+    std::shared_ptr<std::function<void()>> call = std::make_shared<std::function<void()>>(fx);
+    std::function<void()> job = [call, done]() {
+        try {
+            (*call)();
+            *call = nullptr;
+            done->set_value();
+        } catch(...) {
+            *call = nullptr;
+            done->set_exception(std::current_exception());
+        }
+    };
+    if(ses == nullptr) {
+        RopWorkerPool::Task task = [job](const RopSession&) { job(); };
+        if(wait)
+            pool.submit(task);
+        else if(!pool.try_submit(task))
+            return std::future<void>();
+        return result;
+    }
+    std::shared_ptr<AsyncChain> chain = ses->asyncChain;
+    RopWorkerPool::Task task = [chain, job](const RopSession&) { RunChain(chain, job); };
+    {
+        std::lock_guard<std::mutex> guard(chain->lock);
+        if(chain->running) {
+            chain->pending.push_back(AsyncChain::Job(&pool, job));
+            return result;
+        }
+        // under the lock, calls queued meanwhile must not find the chain idle
+        if(!wait) {
+            if(!pool.try_submit(task))
+                return std::future<void>();
+            chain->running = true;
+            return result;
+        }
+        chain->running = true;
+    }
+    try {
+        pool.submit(task);
+    } catch(...) {
+        // calls queued meanwhile start with the next one
+        std::lock_guard<std::mutex> guard(chain->lock);
+        chain->running = false;
+        throw;
+    }
+    return result;
+}
+void RopSessionT::RunChain(const std::shared_ptr<AsyncChain>& chain, std::function<void()> job) {
+    for(;;) {
+        job();
+        AsyncChain::Job next;
+        {
+            std::lock_guard<std::mutex> guard(chain->lock);
+            if(chain->pending.empty()) {
+                chain->running = false;
+                return;
+            }
+            next = std::move(chain->pending.front());
+            chain->pending.pop_front();
+        }
+        // hand the worker to other sessions if the pool has room, never wait for it
+        std::shared_ptr<AsyncChain> self = chain;
+        std::function<void()> fx = next.second;
+        if(next.first->try_submit([self, fx](const RopSession&) { RunChain(self, fx); }))
+            return;
+        job = std::move(next.second);
+    }
+}
 
 
 RopIdIteratorT::RopIdIteratorT(const RopObjRef& parent, const RopHandle iid) : RopObjectT(parent.lock()) {
@@ -277,7 +793,96 @@ RopIdIteratorT::~RopIdIteratorT() {
 
 RopString RopIdIteratorT::next() { API_PROLOG
     const char *identifier = nullptr;
-    return Util::GetRopString(me, CALL(rnp_identifier_iterator_next)(HCAST_IDIT(handle), &identifier), &identifier, false);
+    return Util::GetRopString(*this, CALL(rnp_identifier_iterator_next)(HCAST_IDIT(handle), &identifier), &identifier, false);
+}
+
+
+
+RopSessionPool::RopSessionPool(const RopBind& bind, const size_t size) : bind(bind), count(size>0? size : 1) {
+    keyring = std::make_shared<RopSnapshotT>();
+    gen = 0;
+    idle.reserve(count);
+    for(size_t idx = 0; idx < count; idx++) {
+        Replica replica = { bind->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG), 0, 0, false };
+        idle.push_back(replica);
+    }
+}
+
+void RopSessionPool::refresh(const RopSnapshot& snap) {
+    std::lock_guard<std::mutex> guard(lock);
+    keyring = snap;
+    gen++;
+}
+
+void RopSessionPool::refresh(const RopSession& source) {
+    refresh(source->snapshot());
+}
+
+void RopSessionPool::refresh(const InString& format, const RopInput& input) {
+    RopSession scratch = bind->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    scratch->load_keys(format, input);
+    refresh(scratch->snapshot());
+}
+
+RopSessionPool::Lease RopSessionPool::lease() {
+    Replica replica;
+    RopSnapshot ring;
+    unsigned ringGen = 0;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        available.wait(guard, [this] { return !idle.empty(); });
+        replica = idle.back();
+        idle.pop_back();
+        ring = keyring;
+        ringGen = gen;
+    }
+    if(replica.gen != ringGen || replica.changed) {
+        try {
+            if(replica.changed) {
+                // whatever the last holder installed goes with its keys
+                replica.ses->set_pass_provider(nullptr, nullptr);
+                replica.ses->set_key_provider(nullptr, nullptr);
+            }
+            replica.ses->restore(ring);
+        } catch(...) {
+            // keep it stale so that the next lease retries
+            replica.changed = true;
+            Return(replica);
+            throw;
+        }
+        replica.gen = ringGen;
+        replica.changed = false;
+        replica.edits = replica.ses->keyEdits;
+    }
+    return Lease(this, replica);
+}
+
+void RopSessionPool::Return(const Replica& replica) noexcept {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        idle.push_back(replica);
+        // changed by its holder, reset before it is leased again
+        if(replica.ses->keyEdits != replica.edits)
+            idle.back().changed = true;
+    }
+    available.notify_one();
+}
+
+RopSessionPool::Lease& RopSessionPool::Lease::operator =(Lease&& other) noexcept {
+    if(this != &other) {
+        release();
+        pool = other.pool;
+        replica = std::move(other.replica);
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+void RopSessionPool::Lease::release() noexcept {
+    if(pool != nullptr && replica.ses)
+        pool->Return(replica);
+    pool = nullptr;
+    replica.ses.reset();
 }
 
 } CEROP_NAMESPACE_END
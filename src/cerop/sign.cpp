@@ -56,15 +56,15 @@ RopSignT::~RopSignT() {
 
 RopString RopSignT::get_type() { API_PROLOG
     char *type = nullptr;
-    return Util::GetRopString(me, CALL(rnp_signature_get_type)(HCAST_SIG(handle), &type), &type);
+    return Util::GetRopString(*this, CALL(rnp_signature_get_type)(HCAST_SIG(handle), &type), &type);
 }
 RopString RopSignT::alg() { API_PROLOG
     char *alg = nullptr;
-    return Util::GetRopString(me, CALL(rnp_signature_get_alg)(HCAST_SIG(handle), &alg), &alg);
+    return Util::GetRopString(*this, CALL(rnp_signature_get_alg)(HCAST_SIG(handle), &alg), &alg);
 }
 RopString RopSignT::hash_alg() { API_PROLOG
     char *alg = nullptr;
-    return Util::GetRopString(me, CALL(rnp_signature_get_hash_alg)(HCAST_SIG(handle), &alg), &alg);
+    return Util::GetRopString(*this, CALL(rnp_signature_get_hash_alg)(HCAST_SIG(handle), &alg), &alg);
 }
 Instant RopSignT::creation() { API_PROLOG
     uint32_t create = 0;
@@ -73,11 +73,15 @@ Instant RopSignT::creation() { API_PROLOG
 }
 RopString RopSignT::keyid() { API_PROLOG
     char *result = nullptr;
-    return Util::GetRopString(me, CALL(rnp_signature_get_keyid)(HCAST_SIG(handle), &result), &result);
+    return Util::GetRopString(*this, CALL(rnp_signature_get_keyid)(HCAST_SIG(handle), &result), &result);
 }
 void RopSignT::is_valid() { API_PROLOG
     Util::CheckError(CALL(rnp_signature_is_valid)(HCAST_SIG(handle), 0));
 }
+RopResult<void> RopSignT::try_is_valid() noexcept { TRY_PROLOG
+    return CALL(rnp_signature_is_valid)(HCAST_SIG(handle), 0);
+    TRY_EPILOG
+}
 RopKey RopSignT::get_signer() { API_PROLOG
     rnp_key_handle_t key = nullptr;
     RET_ROP_OBJECT(RopKey, key, CALL(rnp_signature_get_signer)(HCAST_SIG(handle), &key));
@@ -88,7 +92,7 @@ RopData RopSignT::to_json(const bool mpi, const bool raw, const bool grip) { API
     flags |= (grip? RNP_JSON_DUMP_GRIP : 0);
     char *json = nullptr;
     unsigned ret = CALL(rnp_signature_packet_to_json)(HCAST_SIG(handle), flags, &json);
-    return Util::GetRopData(me, ret, json, Util::StrLen(json));
+    return Util::GetRopData(*this, ret, json, Util::StrLen(json));
 }
 
 } CEROP_NAMESPACE_END
@@ -42,45 +42,120 @@ CEROP_NAMESPACE_BEGIN {
 
 RopObjectT::RopObjectT(const RopObject& parent, const RopHandle handle) : parent(parent) {
     this->handle = handle;
-deps = nullptr;
-    thl = nullptr;
+    errq = parent!=nullptr? parent->errq : nullptr;
+    pool = parent!=nullptr? parent->pool : nullptr;
 }
 
-RopObjectT::~RopObjectT() {
-    if(deps != nullptr) {
-        delete deps;
-        deps = nullptr;
-    }
-    if(thl != nullptr) {
-        delete thl;
-        thl = nullptr;
-    }
+RopObjectT::RopObjectT(RopObject&& parent, const RopHandle handle) noexcept : parent(std::move(parent)) {
+    this->handle = handle;
+    errq = this->parent!=nullptr? this->parent->errq : nullptr;
+    pool = this->parent!=nullptr? this->parent->pool : nullptr;
 }
 
+RopObjectT::~RopObjectT() {}
+
 void RopObjectT::Attach(const RopHandle handle) {
     if(handle == nullptr)
         throw RopError(ROPE::ERROR_NULL_HANDLE);
     this->handle = handle;
 }
 
-void RopObjectT::ForwardException(const RopThrowed& thr) {
-    if(thl == nullptr)
-        thl = new RopThrowList();
-    if(thl != nullptr)
-        thl->push_back(thr);
-    if(parent != nullptr)
-        parent->ForwardException(thr);
+void RopObjectT::ForwardException(const std::exception_ptr& ex) noexcept {
+    if(errq != nullptr)
+        errq->Push(ex);
 }
 
 void RopObjectT::ExceptionCheck() {
-    if(thl != nullptr) {
-        while(thl->size() > 0 && thl->front()->handled)
-            thl->erase(thl->begin());
-        if(thl->size() > 0) {
-            thl->front()->handled = true;
-            std::rethrow_exception(thl->front()->ex);
+    if(errq != nullptr) {
+        std::exception_ptr ex = errq->Pop();
+        if(ex)
+            std::rethrow_exception(ex);
+    }
+}
+
+
+void RopErrorQueueT::Push(const std::exception_ptr& ex) noexcept {
+    std::lock_guard<std::mutex> guard(lock);
+    const size_t cnt = count.load(std::memory_order_relaxed);
+    if(cnt < CAPACITY) {
+        ring[(head+cnt) % CAPACITY] = ex;
+        count.store(cnt+1, std::memory_order_relaxed);
+    }
+}
+
+std::exception_ptr RopErrorQueueT::Pop() noexcept {
+    std::lock_guard<std::mutex> guard(lock);
+    std::exception_ptr ex;
+    const size_t cnt = count.load(std::memory_order_relaxed);
+    if(cnt > 0) {
+        std::swap(ex, ring[head]);
+        head = (head+1) % CAPACITY;
+        count.store(cnt-1, std::memory_order_relaxed);
+    }
+    return ex;
+}
+
+
+RopPoolT::RopPoolT() noexcept : cursor(nullptr), end(nullptr), live(0), released(false) {
+    for(size_t idx = 0; idx < CLASSES; idx++)
+        freeList[idx] = nullptr;
+}
+
+RopPoolT::~RopPoolT() {
+    for(void *slab : slabs)
+        ::operator delete(slab);
+}
+
+void* RopPoolT::Allocate(const size_t size) {
+    if(size == 0 || size > GRAIN*CLASSES)
+        return ::operator new(size);
+    const size_t cls = (size-1) / GRAIN;
+    std::lock_guard<std::mutex> guard(lock);
+    void *ptr = freeList[cls];
+    if(ptr != nullptr)
+        freeList[cls] = freeList[cls]->next;
+    else {
+        const size_t len = (cls+1) * GRAIN;
+        if(static_cast<size_t>(end - cursor) < len) {
+            slabs.reserve(slabs.size() + 1);
+            cursor = static_cast<char*>(::operator new(SLAB));
+            end = cursor + SLAB;
+            slabs.push_back(cursor);
         }
+        ptr = cursor;
+        cursor += len;
+    }
+    live++;
+    return ptr;
+}
+
+void RopPoolT::Deallocate(void *const ptr, const size_t size) noexcept {
+    if(size == 0 || size > GRAIN*CLASSES) {
+        ::operator delete(ptr);
+        return;
+    }
+    const size_t cls = (size-1) / GRAIN;
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Block *block = static_cast<Block*>(ptr);
+        block->next = freeList[cls];
+        freeList[cls] = block;
+        last = (--live == 0 && released);
+    }
+    if(last)
+        delete this;
+}
+
+void RopPoolT::Release() noexcept {
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        released = true;
+        last = (live == 0);
     }
+    if(last)
+        delete this;
 }
 
 
@@ -34,14 +34,14 @@
 
 CEROP_NAMESPACE_BEGIN {
 
-RopString Util::GetRopString(const RopObjRef& parent, const int ret, const char*const*const ropStr, const bool freeBuf) {
-    RopString str(ropStr!=nullptr&&*ropStr!=nullptr? new RopStringT(parent, *ropStr, freeBuf) : nullptr);
+RopString Util::GetRopString(const RopObjectT& parent, const int ret, const char*const*const ropStr, const bool freeBuf) {
+    RopString str(ropStr!=nullptr&&*ropStr!=nullptr? std::allocate_shared<RopStringT>(RopPoolAlloc<RopStringT>(parent.pool), parent.me, *ropStr, freeBuf) : nullptr);
     Util::CheckError(ret);
     return str;
 }
 
-RopData Util::GetRopData(const RopObjRef& parent, const int ret, const void*const ropBuf, const size_t bufLen, const bool freeBuf) {
-    RopData data(ropBuf!=nullptr? new RopDataT(parent, ropBuf, bufLen, freeBuf) : nullptr);
+RopData Util::GetRopData(const RopObjectT& parent, const int ret, const void*const ropBuf, const size_t bufLen, const bool freeBuf) {
+    RopData data(ropBuf!=nullptr? std::allocate_shared<RopDataT>(RopPoolAlloc<RopDataT>(parent.pool), parent.me, ropBuf, bufLen, freeBuf) : nullptr);
     Util::CheckError(ret);
     return data;
 }
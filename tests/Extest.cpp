@@ -55,8 +55,26 @@ public:
     static void tearDown();
 
     void test_examples(int argc, char **argv);
+    void test_split_keys();
+    void test_buffered_io();
+    void test_descriptor_io();
+    void test_memory_outputs();
+    void test_segment_input();
+    void test_key_index();
+    void test_key_cache();
+    void test_key_snapshot();
+    void test_async();
+    void test_session_pool();
+    void test_snapshots();
+    void test_try_paths();
+    void test_key_provider();
+    void test_key_shards();
+    void test_reload_keys();
+    void test_import_stream();
     
 protected:
+    static std::vector<std::string> key_fprints(const RopSession& ses);
+
     void right_cmp_json(JsonNode& json, JsonNode& ref_json);
 
     static std::vector<std::string> test_key_ids;
@@ -73,7 +91,7 @@ void RopExamplesTest::setUp() {
     
 void RopExamplesTest::tearDown() {
     std::vector<std::string> fnames;
-    for(std::string name : {"pubring.pgp", "secring.pgp", "encrypted.asc", "signed.asc"})
+    for(std::string name : {"pubring.pgp", "secring.pgp", "encrypted.asc", "signed.asc", "pubring.idx"})
         fnames.push_back(name);
     for(std::string keyid : test_key_ids) {
         fnames.push_back(std::string("key-") + keyid + "-pub.asc");
@@ -134,6 +152,583 @@ void RopExamplesTest::test_examples(int argc, char **argv) {
     right_cmp_json(jso, ref_jso);
 }
     
+void RopExamplesTest::test_split_keys() {
+    typedef std::vector<std::pair<size_t, size_t>> Ranges;
+    auto split = [](const std::vector<uint8_t>& data, Ranges& keys) {
+        keys.clear();
+        return RopKeyIndex::split_keys(data.data(), data.size(), keys);
+    };
+    Ranges keys;
+
+    // new format: userid before the first key, one, two and five octet lengths
+    std::vector<uint8_t> data = {0xcd, 0x01, 'u', 0xc6, 0x03, 1, 2, 3, 0xcd, 0x01, 'v', 0xc5, 0xc0, 0x00};
+    data.resize(data.size() + 192, 0);
+    for(uint8_t byte : {0xc6, 0xff, 0x00, 0x00, 0x00, 0x02, 4, 5})
+        data.push_back(byte);
+    if(!split(data, keys) || keys != Ranges({{3, 8}, {11, 195}, {206, 8}}))
+        throw std::runtime_error("split_keys: new format FAILED!");
+
+    // old format: one, two and four octet lengths, then indeterminate
+    data = {0x98, 0x01, 1, 0xb4, 0x01, 'u', 0x95, 0x00, 0x01, 2, 0x9a, 0x00, 0x00, 0x00, 0x01, 3, 0x9b, 4, 5, 6};
+    if(!split(data, keys) || keys != Ranges({{0, 6}, {6, 4}, {10, 6}, {16, 4}}))
+        throw std::runtime_error("split_keys: old format FAILED!");
+
+    // no keys at all
+    data = {0xcd, 0x01, 'u'};
+    if(!split(data, keys) || !keys.empty())
+        throw std::runtime_error("split_keys: no keys FAILED!");
+
+    // truncated body, truncated length, partial length, not a packet
+    for(const std::vector<uint8_t>& bad : std::vector<std::vector<uint8_t>>{
+            {0xc6, 0x05, 1, 2}, {0xc6, 0xc0}, {0xc6, 0xff, 0x00, 0x00}, {0x99, 0x00}, 
+            {0xc6, 0xe1, 1, 2}, {0x46, 0x01, 1}})
+        if(split(bad, keys))
+            throw std::runtime_error("split_keys: bad framing FAILED!");
+}
+
+void RopExamplesTest::test_buffered_io() {
+    struct Source : InputCallBack {
+        std::vector<uint8_t> data;
+        size_t pos = 0, reads = 0;
+        bool ReadCallBack(void*, void* buf, size_t len, size_t* read) override {
+            reads++;
+            *read = std::min(len, data.size()-pos);
+            std::memcpy(buf, data.data()+pos, *read);
+            pos += *read;
+            return true;
+        }
+        void RCloseCallBack(void*) override {}
+    };
+    struct Sink : OutputCallBack {
+        std::vector<uint8_t> data;
+        std::vector<size_t> writes;
+        bool fail = false, closed = false;
+        bool WriteCallBack(void*, const void* buf, size_t len) override {
+            writes.push_back(len);
+            const uint8_t *src = static_cast<const uint8_t*>(buf);
+            data.insert(data.end(), src, src+len);
+            return !fail;
+        }
+        void WCloseCallBack(void*, bool) override { closed = true; }
+    };
+
+    // reads across the chunk edge, one larger than a chunk, then the end
+    Source src;
+    for(int idx = 0; idx < 40; idx++)
+        src.data.push_back(static_cast<uint8_t>(idx));
+    BufferedInputCallBack inp(src, 8);
+    std::vector<uint8_t> got;
+    uint8_t buf[16];
+    for(size_t len : {3, 3, 3, 12, 5, 16, 16}) {
+        size_t read = 0;
+        if(!inp.ReadCallBack(nullptr, buf, len, &read) || read > len)
+            throw std::runtime_error("BufferedInputCallBack: read FAILED!");
+        got.insert(got.end(), buf, buf+read);
+    }
+    size_t read = 1;
+    if(!inp.ReadCallBack(nullptr, buf, sizeof(buf), &read) || read != 0 || got != src.data)
+        throw std::runtime_error("BufferedInputCallBack: data FAILED!");
+    if(src.reads >= got.size()/2)
+        throw std::runtime_error("BufferedInputCallBack: not buffered FAILED!");
+
+    // writes across the chunk edge and one larger than a chunk
+    Sink sink;
+    BufferedOutputCallBack outp(sink, 8);
+    std::vector<uint8_t> sent;
+    for(size_t len : {5, 5, 20, 3, 4}) {
+        std::vector<uint8_t> part;
+        for(size_t idx = 0; idx < len; idx++)
+            part.push_back(static_cast<uint8_t>(sent.size()+idx));
+        if(!outp.WriteCallBack(nullptr, part.data(), part.size()))
+            throw std::runtime_error("BufferedOutputCallBack: write FAILED!");
+        sent.insert(sent.end(), part.begin(), part.end());
+    }
+    outp.WCloseCallBack(nullptr, false);
+    if(sink.data != sent || !sink.closed || outp.failed() || sink.writes != std::vector<size_t>({5, 5, 20, 7}))
+        throw std::runtime_error("BufferedOutputCallBack: data FAILED!");
+
+    // a failed flush on close is reported
+    Sink broken;
+    BufferedOutputCallBack failing(broken, 8);
+    broken.fail = true;
+    failing.WriteCallBack(nullptr, buf, 4);
+    failing.WCloseCallBack(nullptr, false);
+    if(!failing.failed() || broken.writes.size() != 1)
+        throw std::runtime_error("BufferedOutputCallBack: failed flush FAILED!");
+}
+
+void RopExamplesTest::test_descriptor_io() {
+    RopBind rop = NewRopBind();
+    // negative and closed descriptors are refused up front
+    for(int fd : {-1, 0x7ffff}) {
+        for(int out = 0; out < 2; out++)
+            try {
+                if(out) rop->create_output_fd(fd);
+                else rop->create_input_fd(fd);
+                throw std::runtime_error("Descriptor io: bad fd accepted FAILED!");
+            } catch(RopError& err) {
+                if(err.getErrCode() != ROPE::ERROR_BAD_PARAMETERS)
+                    throw std::runtime_error("Descriptor io: bad fd error FAILED!");
+            }
+    }
+}
+
+void RopExamplesTest::test_memory_outputs() {
+    RopBind rop = NewRopBind();
+    const std::string text = "memory outputs write straight into storage of the caller";
+    std::vector<uint8_t> vec;
+    StringT str;
+    std::vector<uint8_t> fixed(text.size());
+    size_t written = 0;
+    {
+        RopOutput outs[] = {rop->create_output_memory(vec), rop->create_output_memory(str), 
+            rop->create_output_memory(fixed.data(), fixed.size(), &written)};
+        for(RopOutput& output : outs)
+            rop->create_input(RopDataT(text), false)->output_pipe(output);
+    }
+    // complete once the outputs are released
+    if(!(std::string(vec.begin(), vec.end()) == text) || !(str == text))
+        throw std::runtime_error("Memory outputs: growing sinks FAILED!");
+    if(written != text.size() || !(std::string(fixed.begin(), fixed.end()) == text))
+        throw std::runtime_error("Memory outputs: fixed buffer FAILED!");
+}
+
+void RopExamplesTest::test_segment_input() {
+    RopBind rop = NewRopBind();
+    // empty segments anywhere, one with a null base
+    std::string big(100000, 'x');
+    const RopIoVec segs[] = {{nullptr, 0}, {"scattered ", 10}, {"", 0}, {big.data(), big.size()}, {" input", 6}, {nullptr, 0}};
+    std::vector<uint8_t> out;
+    {
+        RopOutput output = rop->create_output_memory(out);
+        rop->create_input(segs, sizeof(segs)/sizeof(segs[0]))->output_pipe(output);
+    }
+    if(!(std::string(out.begin(), out.end()) == "scattered " + big + " input"))
+        throw std::runtime_error("Segment input: data FAILED!");
+
+    std::vector<uint8_t> none;
+    {
+        RopOutput output = rop->create_output_memory(none);
+        rop->create_input(segs, 1)->output_pipe(output);
+    }
+    if(!none.empty())
+        throw std::runtime_error("Segment input: empty FAILED!");
+}
+
+std::vector<std::string> RopExamplesTest::key_fprints(const RopSession& ses) {
+    std::vector<std::string> fprints;
+    RopIdIterator it = ses->identifier_iterator_create("fingerprint");
+    for(RopString fprint = it->next(); fprint; fprint = it->next())
+        fprints.push_back(static_cast<const char*>(*fprint));
+    return fprints;
+}
+
+void RopExamplesTest::test_key_index() {
+    RopBind rop = NewRopBind();
+    RopKeyIndex::build(rop, "pubring.pgp", "pubring.idx");
+    RopKeyIndex index(rop, "pubring.pgp", "pubring.idx");
+
+    RopSession all = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    all->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    std::vector<std::string> fprints = key_fprints(all);
+    if(fprints.empty() || index.size() < fprints.size())
+        throw std::runtime_error("RopKeyIndex: size FAILED!");
+
+    // every key and subkey loads alone, by fingerprint and by keyid
+    for(const std::string& fprint : fprints) {
+        RopKey key = all->locate_key("fingerprint", fprint);
+        std::string keyid(static_cast<const char*>(*key->keyid()));
+        for(const std::pair<const char*, std::string>& id : {std::make_pair("fingerprint", fprint), std::make_pair("keyid", keyid)}) {
+            RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+            if(!index.load_key(ses, id.first, id.second) || !ses->try_locate_key("fingerprint", fprint))
+                throw std::runtime_error("RopKeyIndex: load_key FAILED!");
+            if(ses->public_key_count() >= all->public_key_count() && fprints.size() > 2)
+                throw std::runtime_error("RopKeyIndex: loaded too many keys FAILED!");
+        }
+    }
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    if(index.load_key(ses, "keyid", "0123456789ABCDEF") || ses->public_key_count() != 0)
+        throw std::runtime_error("RopKeyIndex: unknown key FAILED!");
+}
+
+void RopExamplesTest::test_key_cache() {
+    RopBind rop = NewRopBind();
+    std::weak_ptr<RopSessionT> released;
+    {
+        RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+        ses->set_key_cache(2);
+        ses->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+        std::vector<std::string> fprints = key_fprints(ses);
+        RopKey held = ses->locate_key("fingerprint", fprints[0]);
+        for(const std::string& fprint : fprints)
+            for(int idx = 0; idx < 2; idx++)
+                if(!(std::string(static_cast<const char*>(*ses->locate_key("fingerprint", fprint)->fprint())) == fprint))
+                    throw std::runtime_error("Key cache: lookup FAILED!");
+        // the first key is evicted by now, its handle must stay usable
+        if(!(std::string(static_cast<const char*>(*held->fprint())) == fprints[0]))
+            throw std::runtime_error("Key cache: evicted key FAILED!");
+        released = ses;
+    }
+    // neither the cache nor the keys it handed out may keep the session alive
+    if(!released.expired())
+        throw std::runtime_error("Key cache: session not released FAILED!");
+}
+
+void RopExamplesTest::test_key_snapshot() {
+    RopBind rop = NewRopBind();
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    ses->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    ses->load_keys_secret(RopBindT::KEYSTORE_GPG, rop->create_input("secring.pgp"));
+    auto same = [](const RopString& str, const char* field) {
+        return std::string(static_cast<const char*>(*str)) == field;
+    };
+    std::vector<std::string> fprints = key_fprints(ses);
+    std::vector<RopKeySnapshotT> snaps = ses->key_snapshots();
+    if(fprints.empty() || snaps.size() != fprints.size())
+        throw std::runtime_error("Key snapshot: count FAILED!");
+
+    for(size_t idx = 0; idx < fprints.size(); idx++) {
+        RopKey key = ses->locate_key("fingerprint", fprints[idx]);
+        RopKeySnapshotT snap = key->snapshot();
+        if(!(std::string(snap.fprint) == fprints[idx]) || !(std::string(snaps[idx].fprint) == fprints[idx]))
+            throw std::runtime_error("Key snapshot: fingerprint FAILED!");
+        if(!same(key->keyid(), snap.keyid) || !same(key->grip(), snap.grip) || !same(key->alg(), snap.alg))
+            throw std::runtime_error("Key snapshot: strings FAILED!");
+        if(key->is_primary()? !same(key->primary_uid(), snap.primaryUid) : !same(key->primary_fprint(), snap.primaryFprint))
+            throw std::runtime_error("Key snapshot: primary FAILED!");
+        if(snap.bits != key->bits() || snap.creation != key->creation() || snap.uidCount != key->uid_count() || 
+                snap.subkeyCount != key->subkey_count() || snap.signatureCount != key->signature_count())
+            throw std::runtime_error("Key snapshot: numbers FAILED!");
+        // without the capability the validity fields keep their defaults
+        const bool valid = rop->has(RopBindT::Capability::KEY_VALIDITY)? key->is_valid() : false;
+        if(snap.primary != key->is_primary() || snap.valid != valid || snap.revoked != key->is_revoked() || 
+                snap.haveSecret != key->have_secret() || snap.havePublic != key->have_public() || !snap.haveSecret)
+            throw std::runtime_error("Key snapshot: flags FAILED!");
+    }
+}
+
+void RopExamplesTest::test_async() {
+    RopBind rop = NewRopBind();
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    ses->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    ses->load_keys_secret(RopBindT::KEYSTORE_GPG, rop->create_input("secring.pgp"));
+    Decrypt passwords;
+    ses->set_pass_provider(&passwords, nullptr);
+    const std::string message = "ROP async sample message";
+    const size_t count = 6;
+
+    // one worker and a single queue slot, calls of one session queue up in the session
+    RopWorkerPool pool(1, 1);
+    std::vector<std::vector<uint8_t>> encrypted(count), decrypted(count);
+    {
+        std::vector<std::future<void>> done;
+        std::vector<RopOpEncrypt> ops;
+        for(size_t idx = 0; idx < count; idx++) {
+            RopOpEncrypt op = ses->op_encrypt_create(rop->create_input(message, false), rop->create_output_memory(encrypted[idx]));
+            op->add_recipient(ses->locate_key("userid", "rsa@key"));
+            done.push_back(op->execute_async(pool, false));
+            if(!done.back().valid())
+                throw std::runtime_error("Async: encrypt not queued FAILED!");
+            ops.push_back(op);
+        }
+        for(std::future<void>& fut : done)
+            fut.get();
+    }
+    {
+        std::vector<std::future<void>> done;
+        for(size_t idx = 0; idx < count; idx++) {
+            RopInput input = rop->create_input(RopDataT(encrypted[idx].data(), encrypted[idx].size()), false);
+            done.push_back(ses->decrypt_async(pool, input, rop->create_output_memory(decrypted[idx])));
+        }
+        for(std::future<void>& fut : done)
+            fut.get();
+    }
+    for(const std::vector<uint8_t>& plain : decrypted)
+        if(!(std::string(plain.begin(), plain.end()) == message))
+            throw std::runtime_error("Async: round trip FAILED!");
+
+    // failures reach the future
+    std::vector<uint8_t> garbage(16, 0x55), out;
+    std::future<void> bad = ses->decrypt_async(pool, rop->create_input(RopDataT(garbage.data(), garbage.size()), false), rop->create_output_memory(out));
+    try {
+        bad.get();
+        throw std::runtime_error("Async: bad input decrypted FAILED!");
+    } catch(RopError&) {}
+}
+
+void RopExamplesTest::test_session_pool() {
+    RopBind rop = NewRopBind();
+    RopSessionPool pool(rop, 2);
+    pool.refresh(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    size_t full = 0;
+    {
+        RopSessionPool::Lease first = pool.lease(), second = pool.lease();
+        full = first->public_key_count();
+        if(full == 0 || second->public_key_count() != full || first.get() == second.get())
+            throw std::runtime_error("Session pool: lease FAILED!");
+    }
+
+    // a holder removing a key does not leak into the next lease
+    {
+        RopSessionPool::Lease lease = pool.lease();
+        std::vector<std::string> fprints = key_fprints(lease.get());
+        RopKey key = lease->locate_key("fingerprint", fprints[0]);
+        key->remove(true, false, true);
+    }
+    {
+        RopSessionPool::Lease first = pool.lease(), second = pool.lease();
+        if(first->public_key_count() != full || second->public_key_count() != full)
+            throw std::runtime_error("Session pool: changed session returned FAILED!");
+    }
+
+    // refresh reaches every replica on its next lease
+    RopSession source = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    source->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    std::vector<std::string> fprints = key_fprints(source);
+    source->locate_key("fingerprint", fprints[0])->remove(true, false, true);
+    const size_t fewer = source->public_key_count();
+    pool.refresh(source);
+    {
+        RopSessionPool::Lease first = pool.lease(), second = pool.lease();
+        if(fewer >= full || first->public_key_count() != fewer || second->public_key_count() != fewer)
+            throw std::runtime_error("Session pool: refresh FAILED!");
+        if(first->try_locate_key("fingerprint", fprints[0]))
+            throw std::runtime_error("Session pool: refreshed keys FAILED!");
+    }
+}
+
+void RopExamplesTest::test_snapshots() {
+    RopBind rop = NewRopBind();
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    ses->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    ses->load_keys_secret(RopBindT::KEYSTORE_GPG, rop->create_input("secring.pgp"));
+    const std::vector<std::string> fprints = key_fprints(ses);
+    RopSnapshot snap = ses->snapshot();
+    if(!snap || snap->pub.empty() || snap->sec.empty())
+        throw std::runtime_error("Snapshot: empty FAILED!");
+    auto same = [&](RopSession& other) {
+        if(key_fprints(other) != fprints || other->secret_key_count() != ses->secret_key_count())
+            return false;
+        for(const std::string& fprint : fprints)
+            if(!other->locate_key("fingerprint", fprint)->have_secret())
+                return false;
+        return true;
+    };
+
+    RopSession restored = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    restored->restore(snap);
+    if(!same(restored))
+        throw std::runtime_error("Snapshot: restore FAILED!");
+
+    // a clone is independent of its source
+    RopSession cloned = ses->clone();
+    if(!same(cloned))
+        throw std::runtime_error("Snapshot: clone FAILED!");
+    cloned->locate_key("fingerprint", fprints[0])->remove(true, true, true);
+    if(cloned->public_key_count() >= ses->public_key_count() || key_fprints(ses) != fprints)
+        throw std::runtime_error("Snapshot: clone shares keys FAILED!");
+
+    // restore replaces the keys rather than adding to them
+    cloned->restore(snap);
+    if(!same(cloned))
+        throw std::runtime_error("Snapshot: restore over changes FAILED!");
+    cloned->restore(std::make_shared<RopSnapshotT>());
+    if(cloned->public_key_count() != 0 || cloned->secret_key_count() != 0)
+        throw std::runtime_error("Snapshot: empty restore FAILED!");
+}
+
+void RopExamplesTest::test_try_paths() {
+    RopBind rop = NewRopBind();
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    RopResult<RopData> imported = ses->try_import_keys(rop->create_input("pubring.pgp"));
+    if(!imported || !*imported)
+        throw std::runtime_error("Try: import FAILED!");
+    std::vector<uint8_t> garbage(32, 0x55);
+    if(ses->try_import_keys(rop->create_input(RopDataT(garbage.data(), garbage.size()), false)))
+        throw std::runtime_error("Try: bad import FAILED!");
+    const std::vector<std::string> fprints = key_fprints(ses);
+
+    RopResult<RopKey> hit = ses->try_locate_key("fingerprint", fprints[0]);
+    if(!hit || !(std::string(static_cast<const char*>(*hit.get()->fprint())) == fprints[0]))
+        throw std::runtime_error("Try: locate hit FAILED!");
+    RopResult<RopKey> miss = ses->try_locate_key("keyid", "0123456789ABCDEF");
+    if(miss || miss.getErrCode() != ROPE::ERROR_KEY_NOT_FOUND)
+        throw std::runtime_error("Try: locate miss FAILED!");
+    try {
+        miss.get();
+        throw std::runtime_error("Try: get on a miss FAILED!");
+    } catch(RopError& err) {
+        if(err.getErrCode() != ROPE::ERROR_KEY_NOT_FOUND)
+            throw std::runtime_error("Try: get error FAILED!");
+    }
+
+    // misses are empty entries, other failures throw
+    std::vector<RopKey> keys = ses->locate_keys("fingerprint", {fprints[0], "0123456789ABCDEF0123456789ABCDEF01234567", fprints[1]});
+    if(keys.size() != 3 || !keys[0] || keys[1] || !keys[2])
+        throw std::runtime_error("Try: locate_keys FAILED!");
+    try {
+        ses->locate_keys("no such type", {fprints[0]});
+        throw std::runtime_error("Try: locate_keys bad type FAILED!");
+    } catch(RopError&) {}
+
+    // the non-throwing variants agree with the throwing ones
+    RopSign sig = ses->locate_key("userid", "rsa@key")->get_uid_handle_at(0)->get_signature_at(0);
+    unsigned code = ROPE::SUCCESS;
+    try {
+        sig->is_valid();
+    } catch(RopError& err) {
+        code = err.getErrCode();
+    }
+    if(sig->try_is_valid().getErrCode() != code)
+        throw std::runtime_error("Try: is_valid FAILED!");
+    std::vector<uint8_t> out;
+    RopOpVerify verify = ses->op_verify_create(rop->create_input(RopDataT(garbage.data(), garbage.size()), false), rop->create_output_memory(out));
+    if(verify->try_execute())
+        throw std::runtime_error("Try: verify garbage FAILED!");
+}
+
+void RopExamplesTest::test_key_provider() {
+    RopBind rop = NewRopBind();
+    KeyringKeyProvider provider(rop);
+    provider.add("pubring.pgp");
+
+    RopSession all = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    all->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    std::vector<std::string> fprints = key_fprints(all);
+    if(fprints.empty() || provider.size() < fprints.size())
+        throw std::runtime_error("KeyringKeyProvider: size FAILED!");
+
+    // hits load the key on demand, by fingerprint and by keyid
+    for(const std::string& fprint : fprints) {
+        std::string keyid(static_cast<const char*>(*all->locate_key("fingerprint", fprint)->keyid()));
+        for(const std::pair<const char*, std::string>& id : {std::make_pair("fingerprint", fprint), std::make_pair("keyid", keyid)}) {
+            RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+            if(!provider.load_key(ses, id.first, id.second) || !ses->try_locate_key("fingerprint", fprint))
+                throw std::runtime_error("KeyringKeyProvider: load_key FAILED!");
+        }
+    }
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    if(provider.load_key(ses, "keyid", "0123456789ABCDEF") || provider.load_key(ses, "userid", "nobody@key") || ses->public_key_count() != 0)
+        throw std::runtime_error("KeyringKeyProvider: miss FAILED!");
+
+    // installed as the key provider, a lookup pulls the key in
+    ses->set_key_provider(&provider, nullptr);
+    if(!ses->try_locate_key("fingerprint", fprints[0]) || ses->try_locate_key("keyid", "0123456789ABCDEF"))
+        throw std::runtime_error("KeyringKeyProvider: callback FAILED!");
+    ses->set_key_provider(nullptr, nullptr);
+}
+
+void RopExamplesTest::test_key_shards() {
+    RopBind rop = NewRopBind();
+    RopSession all = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    all->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    std::vector<std::string> fprints = key_fprints(all);
+
+    // more threads than keys, no shard is left empty
+    RopKeyShards shards(rop, "pubring.pgp", 8);
+    if(shards.size() < 1 || shards.size() > all->public_key_count())
+        throw std::runtime_error("RopKeyShards: size FAILED!");
+    size_t total = 0;
+    for(size_t idx = 0; idx < shards.size(); idx++) {
+        if(shards.shard(idx)->public_key_count() == 0)
+            throw std::runtime_error("RopKeyShards: empty shard FAILED!");
+        total += shards.shard(idx)->public_key_count();
+    }
+    if(total != all->public_key_count())
+        throw std::runtime_error("RopKeyShards: split FAILED!");
+
+    // every key is found whichever shard holds it
+    for(const std::string& fprint : fprints) {
+        RopKey key = shards.locate_key("fingerprint", fprint);
+        if(!key || !(std::string(static_cast<const char*>(*key->fprint())) == fprint))
+            throw std::runtime_error("RopKeyShards: lookup FAILED!");
+    }
+    if(shards.locate_key("userid", "rsa@key") == nullptr || shards.locate_key("keyid", "0123456789ABCDEF") != nullptr)
+        throw std::runtime_error("RopKeyShards: identifier FAILED!");
+
+    RopKeyShards single(rop, "pubring.pgp", 1);
+    if(single.size() != 1 || single.shard(0)->public_key_count() != all->public_key_count())
+        throw std::runtime_error("RopKeyShards: single shard FAILED!");
+}
+
+void RopExamplesTest::test_reload_keys() {
+    RopBind rop = NewRopBind();
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    ses->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    ses->load_keys_secret(RopBindT::KEYSTORE_GPG, rop->create_input("secring.pgp"));
+    // unprotected, so it can be changed without a password
+    ses->generate_key_json(std::string("{'primary': {'type': 'EDDSA', 'userid': 'reload@key', 'usage': ['sign']}}"));
+    const std::string unchanged = static_cast<const char*>(*ses->locate_key("userid", "rsa@key")->fprint());
+    const std::string changed = static_cast<const char*>(*ses->locate_key("userid", "reload@key")->fprint());
+    const std::string removed = static_cast<const char*>(*ses->locate_key("userid", "25519@key")->fprint());
+
+    // the keyring as it is updated elsewhere
+    RopSession other = ses->clone();
+    other->locate_key("fingerprint", changed)->set_expiration(Duration(3600));
+    other->locate_key("fingerprint", removed)->remove(true, true, true);
+    RopSnapshot snap = other->snapshot();
+    std::vector<uint8_t> keyring(snap->pub);
+    keyring.insert(keyring.end(), snap->sec.begin(), snap->sec.end());
+
+    std::vector<std::string> expected = key_fprints(other);
+    std::sort(expected.begin(), expected.end());
+    RopKey held = ses->locate_key("fingerprint", unchanged);
+    for(int idx = 0; idx < 2; idx++) {
+        ses->reload_keys(RopBindT::KEYSTORE_GPG, rop->create_input(RopDataT(keyring.data(), keyring.size()), false));
+        // reimported keys may come back in another order
+        std::vector<std::string> fprints = key_fprints(ses);
+        std::sort(fprints.begin(), fprints.end());
+        if(fprints != expected || ses->public_key_count() != other->public_key_count() || 
+                ses->secret_key_count() != other->secret_key_count())
+            throw std::runtime_error("Reload: keys FAILED!");
+        if(ses->try_locate_key("fingerprint", removed))
+            throw std::runtime_error("Reload: removed key FAILED!");
+        if(ses->locate_key("fingerprint", changed)->expiration() != Duration(3600) || !ses->locate_key("fingerprint", changed)->have_secret())
+            throw std::runtime_error("Reload: changed key FAILED!");
+        // the handle of a key the input did not change is still good
+        if(!(std::string(static_cast<const char*>(*held->fprint())) == unchanged) || !held->have_secret())
+            throw std::runtime_error("Reload: unchanged key FAILED!");
+    }
+}
+
+void RopExamplesTest::test_import_stream() {
+    struct Collect : public SessionImportCallBack {
+        size_t stopAfter = 0;
+        std::vector<Key> keys;
+        virtual bool ImportCallBack(const RopSession& ses, void* ctx, const Key& key) override {
+            keys.push_back(key);
+            return keys.size() != stopAfter;
+        }
+    };
+    RopBind rop = NewRopBind();
+    RopSession all = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    all->load_keys_public(RopBindT::KEYSTORE_GPG, rop->create_input("pubring.pgp"));
+    std::vector<std::string> fprints = key_fprints(all);
+
+    // stopped from the first callback, the rest of that key's batch is still reported
+    RopSession ses = rop->create_session(RopBindT::KEYSTORE_GPG, RopBindT::KEYSTORE_GPG);
+    Collect first;
+    first.stopAfter = 1;
+    const size_t count = ses->import_keys_stream(rop->create_input("pubring.pgp"), &first, nullptr);
+    if(count != first.keys.size() || count < 1 || count >= fprints.size() || ses->public_key_count() != count)
+        throw std::runtime_error("Import stream: early stop FAILED!");
+    for(const SessionImportCallBack::Key& key : first.keys)
+        if(key.pub != SessionImportCallBack::NEW || key.sec != SessionImportCallBack::NONE || !ses->try_locate_key("fingerprint", key.fprint))
+            throw std::runtime_error("Import stream: early status FAILED!");
+
+    // the whole stream, keys imported above are unchanged
+    Collect rest;
+    if(ses->import_keys_stream(rop->create_input("pubring.pgp"), &rest, nullptr) != fprints.size() || rest.keys.size() != fprints.size())
+        throw std::runtime_error("Import stream: count FAILED!");
+    for(size_t idx = 0; idx < rest.keys.size(); idx++) {
+        const SessionImportCallBack::Status expected = idx < count? SessionImportCallBack::UNCHANGED : SessionImportCallBack::NEW;
+        if(!(std::string(rest.keys[idx].fprint) == fprints[idx]) || rest.keys[idx].pub != expected)
+            throw std::runtime_error("Import stream: status FAILED!");
+    }
+    if(ses->public_key_count() != all->public_key_count())
+        throw std::runtime_error("Import stream: keys FAILED!");
+}
+
 void RopExamplesTest::right_cmp_json(JsonNode& json, JsonNode& ref_json) {
     if(ref_json.arr)
         for(size_t idx = 0; idx < ref_json.arr->size(); idx++) 
@@ -151,6 +746,22 @@ int main(int argc, char **argv) {
     RopExamplesTest::setUp();
     RopExamplesTest *tex = new RopExamplesTest();
     tex->test_examples(argc, argv);
+    tex->test_split_keys();
+    tex->test_buffered_io();
+    tex->test_descriptor_io();
+    tex->test_memory_outputs();
+    tex->test_segment_input();
+    tex->test_key_index();
+    tex->test_key_cache();
+    tex->test_key_snapshot();
+    tex->test_async();
+    tex->test_session_pool();
+    tex->test_snapshots();
+    tex->test_try_paths();
+    tex->test_key_provider();
+    tex->test_key_shards();
+    tex->test_reload_keys();
+    tex->test_import_stream();
     delete tex;
     RopExamplesTest::tearDown();
     std::cout << std::endl << "SUCCESS !" << std::endl;